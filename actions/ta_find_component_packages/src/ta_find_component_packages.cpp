@@ -61,6 +61,7 @@ void executeTemotoAction()
 
     // Read in the component descriptors
     std::vector<temoto_component_manager::ComponentInfo> component_infos;
+    bool scan_complete = true;
     for (const std::string& desc_file_path : component_desc_file_paths)
     {
       try
@@ -74,22 +75,22 @@ void executeTemotoAction()
       {
         // Rethrow the exception
         TEMOTO_ERROR_STREAM(e.what() << " in " << desc_file_path);
+        scan_complete = false;
       }
     }
 
     TEMOTO_DEBUG_STREAM("got " << component_infos.size() << " components");
 
-    for (auto si : component_infos)
+    // Add the components in one batch, so that the registry publishes a single new snapshot
+    unsigned int added_count = cir->addLocalComponents(component_infos);
+    if (added_count != 0)
     {
-      if (cir->addLocalComponent(si))
-      {
-        TEMOTO_INFO("Added a new component");
-      }
-      else
-      {
-        TEMOTO_DEBUG("This component already exists in the CID");
-      }
+      TEMOTO_INFO_STREAM("Added " << added_count << " new components");
     }
+
+    // Refresh the components restored from the previous run and drop the ones that do not exist anymore
+    cir->reconcileRestoredComponents(component_infos, scan_complete);
+
     // Sleep for 10 seconds
     sleepAndCheckOk(10);
   }
@@ -222,6 +223,9 @@ std::vector<temoto_component_manager::ComponentInfo> parseComponents(const YAML:
 
   TEMOTO_DEBUG("Parsing %lu components.", components_node.size());
 
+  // The components parsed so far, for detecting duplicates
+  temoto_component_manager::ComponentInfoSet parsed_components;
+
   // go over each component node in the sequence
   unsigned int i = 0;
   for (YAML::const_iterator node_it = components_node.begin(); node_it != components_node.end(); ++node_it)
@@ -236,12 +240,7 @@ std::vector<temoto_component_manager::ComponentInfo> parseComponents(const YAML:
     try
     {
       temoto_component_manager::ComponentInfo component = node_it->as<temoto_component_manager::ComponentInfo>();
-      if (std::count_if( components.begin()
-                       , components.end()
-                       , [&](const temoto_component_manager::ComponentInfo& s)
-                         {
-                            return s == component;
-                         }) == 0)
+      if (parsed_components.insert(component).second)
       {
         // OK, this is unique pointer, add it to the components vector.
         components.emplace_back(component);
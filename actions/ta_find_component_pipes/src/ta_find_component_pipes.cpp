@@ -61,6 +61,7 @@ void executeTemotoAction()
 
     // Read in the pipe infos
     temoto_component_manager::PipeInfos pipe_infos;
+    bool scan_complete = true;
     for (const std::string& desc_file_path : pipe_desc_file_paths)
     {
       try
@@ -73,23 +74,23 @@ void executeTemotoAction()
       catch(...)
       {
         // TODO: implement a proper catch block
+        TEMOTO_ERROR_STREAM("Could not read the pipes in " << desc_file_path);
+        scan_complete = false;
       }
     }
 
     TEMOTO_DEBUG_STREAM("got " << pipe_infos.size() << " pipes");
 
-    for (auto pi : pipe_infos)
+    // Add the pipes in one batch, so that the registry publishes a single new snapshot
+    unsigned int added_count = cir->addPipes(pipe_infos);
+    if (added_count != 0)
     {
-      if (cir->addPipe(pi))
-      {
-        TEMOTO_INFO("Added a new pipe");
-      }
-      else
-      {
-        TEMOTO_DEBUG("This pipe already exists in the CID");
-      }
+      TEMOTO_INFO_STREAM("Added " << added_count << " new pipes");
     }
 
+    // Drop the pipes restored from the previous run that do not exist anymore
+    cir->reconcileRestoredPipes(pipe_infos, scan_complete);
+
     // Sleep for 10 seconds
     sleepAndCheckOk(10);
   }
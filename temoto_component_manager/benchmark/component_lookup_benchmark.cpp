@@ -0,0 +1,253 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Author: Robert Valner */
+
+/*
+ * Compares the identity field lookups of ComponentInfo before and after the fields were
+ * interned. The "string" path mirrors the former ComponentInfo, whose getters returned the
+ * identity fields as std::string by value, the "symbol" path uses the interned fields.
+ * Both paths run the identity filter of ComponentInfoRegistry::findComponents and the
+ * identity comparison of operator== over the same set of components.
+ *
+ * Usage: component_lookup_benchmark [component count] [iterations]
+ */
+
+#include "temoto_component_manager/component_info.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace
+{
+std::atomic<unsigned long> allocation_count(0);
+}
+
+void* operator new(std::size_t size)
+{
+  allocation_count++;
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+namespace
+{
+using namespace temoto_component_manager;
+
+/**
+ * @brief Identity fields of a component as they were stored before interning
+ */
+class StringIdentity
+{
+public:
+  explicit StringIdentity(const ComponentInfo& ci)
+  : temoto_namespace_(ci.getTemotoNamespace())
+  , name_(ci.getName())
+  , type_(ci.getType())
+  , package_name_(ci.getPackageName())
+  , executable_(ci.getExecutable())
+  {}
+
+  // The getters return by value, as the former ComponentInfo getters did
+  std::string getTemotoNamespace() const { return temoto_namespace_; }
+  std::string getName() const { return name_; }
+  std::string getType() const { return type_; }
+  std::string getPackageName() const { return package_name_; }
+  std::string getExecutable() const { return executable_; }
+
+  bool operator==(const StringIdentity& other) const
+  {
+    return getTemotoNamespace() == other.getTemotoNamespace()
+        && getName() == other.getName()
+        && getType() == other.getType()
+        && getPackageName() == other.getPackageName()
+        && getExecutable() == other.getExecutable();
+  }
+
+private:
+  std::string temoto_namespace_;
+  std::string name_;
+  std::string type_;
+  std::string package_name_;
+  std::string executable_;
+};
+
+struct Result
+{
+  double ns_per_lookup;
+  double allocations_per_lookup;
+  std::size_t matches;
+};
+
+template <class Lookup>
+Result measure(unsigned int iterations, Lookup lookup)
+{
+  std::size_t matches = 0;
+  unsigned long allocations_before = allocation_count;
+  auto start = std::chrono::steady_clock::now();
+
+  for (unsigned int i=0; i<iterations; i++)
+  {
+    matches += lookup(i);
+  }
+
+  auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+  unsigned long allocations = allocation_count - allocations_before;
+  return Result{ double(duration.count()) / iterations
+               , double(allocations) / iterations
+               , matches };
+}
+
+void print(const std::string& name, const Result& result)
+{
+  std::cout << "  " << name
+            << ": " << result.ns_per_lookup << " ns/lookup"
+            << ", " << result.allocations_per_lookup << " allocations/lookup"
+            << " (" << result.matches << " matches)" << std::endl;
+}
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+  unsigned int component_count = (argc > 1) ? std::atoi(argv[1]) : 500;
+  unsigned int iterations = (argc > 2) ? std::atoi(argv[2]) : 2000;
+
+  // Build a workspace like set of components, a few types spread over a few packages
+  std::vector<ComponentInfo> components;
+  std::vector<StringIdentity> string_components;
+  for (unsigned int i=0; i<component_count; i++)
+  {
+    ComponentInfo ci("component_" + std::to_string(i));
+    ci.setType("component_type_" + std::to_string(i % 10));
+    ci.setPackageName("package_" + std::to_string(i % 50));
+    ci.setExecutable("executable_" + std::to_string(i) + ".launch");
+    components.push_back(ci);
+    string_components.emplace_back(ci);
+  }
+
+  // Requests of a LoadComponent call, one per type
+  std::vector<std::string> requested_types;
+  std::vector<std::string> requested_packages;
+  for (unsigned int i=0; i<10; i++)
+  {
+    requested_types.push_back("component_type_" + std::to_string(i));
+    requested_packages.push_back("package_" + std::to_string(i));
+  }
+
+  std::cout << component_count << " components, " << iterations << " iterations" << std::endl;
+
+  /*
+   * Filter by type and package name, as findComponents does for every candidate
+   */
+  std::cout << "findComponents identity filter:" << std::endl;
+  print("string", measure(iterations, [&](unsigned int i)
+  {
+    const std::string& type = requested_types[i % requested_types.size()];
+    const std::string& package_name = requested_packages[i % requested_packages.size()];
+    std::size_t matches = 0;
+    for (const auto& s : string_components)
+    {
+      if (s.getType() != type)
+      {
+        continue;
+      }
+      if (s.getPackageName() != package_name)
+      {
+        continue;
+      }
+      matches++;
+    }
+    return matches;
+  }));
+
+  print("symbol", measure(iterations, [&](unsigned int i)
+  {
+    // The request strings are resolved once per lookup, the candidates are compared by symbol
+    Symbol type;
+    Symbol package_name;
+    if (!SymbolTable::identifiers().find(requested_types[i % requested_types.size()], type)
+    ||  !SymbolTable::identifiers().find(requested_packages[i % requested_packages.size()], package_name))
+    {
+      return std::size_t(0);
+    }
+    std::size_t matches = 0;
+    for (const auto& s : components)
+    {
+      if (s.getTypeSymbol() != type)
+      {
+        continue;
+      }
+      if (s.getPackageNameSymbol() != package_name)
+      {
+        continue;
+      }
+      matches++;
+    }
+    return matches;
+  }));
+
+  /*
+   * Find a component by identity, as the allocation bookkeeping did with operator==
+   */
+  std::cout << "operator== search:" << std::endl;
+  print("string", measure(iterations, [&](unsigned int i)
+  {
+    const StringIdentity& wanted = string_components[(i * 7919) % string_components.size()];
+    std::size_t matches = 0;
+    for (const auto& s : string_components)
+    {
+      if (s == wanted)
+      {
+        matches++;
+      }
+    }
+    return matches;
+  }));
+
+  print("symbol", measure(iterations, [&](unsigned int i)
+  {
+    const ComponentInfo& wanted = components[(i * 7919) % components.size()];
+    std::size_t matches = 0;
+    for (const auto& s : components)
+    {
+      if (s == wanted)
+      {
+        matches++;
+      }
+    }
+    return matches;
+  }));
+
+  return 0;
+}
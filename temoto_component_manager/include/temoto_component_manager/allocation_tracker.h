@@ -0,0 +1,172 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Author: Robert Valner */
+
+#ifndef TEMOTO_COMPONENT_MANAGER__ALLOCATION_TRACKER_H
+#define TEMOTO_COMPONENT_MANAGER__ALLOCATION_TRACKER_H
+
+#include "temoto_core/common/temoto_id.h"
+#include "temoto_component_manager/component_info.h"
+#include "temoto_component_manager/pipe_info.h"
+#include "temoto_component_manager/component_manager_services.h"
+#include "temoto_er_manager/temoto_er_manager_services.h"
+
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+namespace temoto_component_manager
+{
+
+/**
+ * @brief Keeps the components and pipes that are allocated by the Component Manager servers.
+ * The allocations are hashed by their resource id and indexed by package+executable, by
+ * component type and by the resource ids of the pipe segments, so that the status callbacks
+ * and the reuse of running components do not depend on the number of live allocations.
+ * All methods return copies and are safe to call from concurrent requests.
+ */
+class AllocationTracker
+{
+public:
+
+  typedef temoto_core::temoto_id::ID ID;
+
+  struct Component
+  {
+    ComponentInfoConstPtr component;
+    LoadComponent::Response res;
+
+    /// The External Resource Manager request of a local component
+    temoto_er_manager::LoadExtResource load_er_msg;
+
+    /// Remote components are loaded by other managers and can not be reused locally
+    bool local = false;
+  };
+
+  struct Pipe
+  {
+    PipeInfoConstPtr pipe;
+
+    /// Resource ids of the segments
+    std::vector<int> sub_resource_ids;
+  };
+
+  /**
+   * @brief Adds or replaces the component allocation with the given resource id
+   */
+  void addComponent(ID resource_id, const Component& component);
+
+  /**
+   * @brief Removes a component allocation
+   * @return false if there was no such allocation
+   */
+  bool removeComponent(ID resource_id);
+
+  /**
+   * @brief Returns the component allocation with the given resource id
+   * @return false if there is no such allocation
+   */
+  bool findComponent(ID resource_id, Component& component) const;
+
+  /**
+   * @brief Replaces the component info of an allocation, e.g. after its reliability was adjusted
+   * @return false if there is no such allocation
+   */
+  bool updateComponent(ID resource_id, ComponentInfoConstPtr component);
+
+  /**
+   * @brief Returns the oldest local allocation that runs any of the candidates. The candidates
+   * are checked in the given order
+   * @return false if none of the candidates is running
+   */
+  bool findRunningComponent( const ComponentInfoConstPtrs& candidates
+                           , ID& resource_id
+                           , Component& component) const;
+
+  /**
+   * @brief Returns the number of local allocations that run the package and the executable of \p ci
+   */
+  std::size_t getUseCount(const ComponentInfo& ci) const;
+
+  /**
+   * @brief Returns the resource ids of the allocations that run a component of the given type
+   * and are less reliable than \p ci
+   */
+  std::vector<ID> findLessReliable(const ComponentInfo& ci) const;
+
+  /**
+   * @brief Adds or replaces the pipe allocation with the given resource id
+   */
+  void addPipe(ID resource_id, const Pipe& pipe);
+
+  /**
+   * @brief Removes a pipe allocation
+   * @return false if there was no such allocation
+   */
+  bool removePipe(ID resource_id);
+
+  /**
+   * @brief Returns the pipe that has a segment with the given resource id. If several pipes
+   * share the segment, the one that was allocated first is returned
+   * @return false if no pipe has such segment
+   */
+  bool findPipeBySegment(int sub_resource_id, ID& resource_id, Pipe& pipe) const;
+
+  /**
+   * @brief Replaces the pipe info of an allocation, e.g. after its reliability was adjusted
+   * @return false if there is no such allocation
+   */
+  bool updatePipe(ID resource_id, PipeInfoConstPtr pipe);
+
+private:
+
+  /// Resource ids in the order of allocation
+  typedef std::vector<ID> IdBucket;
+  typedef std::unordered_map<uint64_t, IdBucket> IdBucketMap;
+
+  static void eraseFromBucket(IdBucketMap& buckets, uint64_t key, ID resource_id);
+
+  /**
+   * @brief Checks if both allocations go to the same buckets
+   */
+  static bool hasSameIndexKeys(const Component& c1, const Component& c2);
+
+  /// Must be called with #mutex_ locked
+  void indexComponent(ID resource_id, const Component& component);
+  void unindexComponent(ID resource_id, const Component& component);
+  void unindexPipe(ID resource_id, const Pipe& pipe);
+
+  std::unordered_map<ID, Component> components_;
+
+  /// Local allocations per package+executable, the size of a bucket is the use count
+  IdBucketMap by_package_executable_;
+
+  /// Allocations per component type
+  IdBucketMap by_type_;
+
+  std::unordered_map<ID, Pipe> pipes_;
+
+  /// Pipes per segment resource id
+  IdBucketMap by_segment_;
+
+  mutable std::mutex mutex_;
+};
+
+} // component_manager namespace
+
+#endif
@@ -22,9 +22,12 @@
 #include "temoto_core/common/temoto_log_macros.h"
 #include "temoto_core/common/topic_container.h" // temoto_core::StringPair
 #include "temoto_core/common/reliability.h"
+#include "temoto_component_manager/symbol_table.h"
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_set>
+#include <cstdint>
 #include <ctype.h>
 #include <memory> // shared_ptr
 #include "yaml-cpp/yaml.h"
@@ -32,6 +35,8 @@
 namespace temoto_component_manager
 {
 
+class LaunchPlan;
+
 class ComponentInfo
 {
 public:
@@ -50,10 +55,10 @@ public:
    * * * * * * * * * * * */
 
   // Get the temoto namespace where this component is defined
-  std::string getTemotoNamespace() const;
+  const std::string& getTemotoNamespace() const;
 
   /// Get name
-  std::string getName() const;
+  const std::string& getName() const;
 
   // Get input topics
   const std::vector<temoto_core::StringPair>& getInputTopics() const;
@@ -67,30 +72,42 @@ public:
   const std::vector<temoto_core::StringPair>& getRequiredParameters() const;
   std::vector<diagnostic_msgs::KeyValue> getRequiredParametersAsKeyVal() const;
 
+  // Get the interned types of input topics, output topics and required parameters
+  const SymbolMask& getInputTopicTypes() const;
+  const SymbolMask& getOutputTopicTypes() const;
+  const SymbolMask& getRequiredParameterTypes() const;
+
   // Get topic by type
-  std::string getTopicByType(const std::string& type, const std::vector<temoto_core::StringPair>& topics);
+  std::string getTopicByType(const std::string& type, const std::vector<temoto_core::StringPair>& topics) const;
 
   // Get input topic
-  std::string getInputTopic(const std::string& type);
+  std::string getInputTopic(const std::string& type) const;
 
   // Get output topic
-  std::string getOutputTopic(const std::string& type);
+  std::string getOutputTopic(const std::string& type) const;
 
   // Get required parameter
-  std::string getRequiredParameter(const std::string& type);
+  std::string getRequiredParameter(const std::string& type) const;
   
 
   // Get component type
-  std::string getType() const;
+  const std::string& getType() const;
 
   // Get component package name
-  std::string getPackageName() const;
+  const std::string& getPackageName() const;
 
   // Get executable
-  std::string getExecutable() const;
+  const std::string& getExecutable() const;
 
   // Get description
-  std::string getDescription() const;
+  const std::string& getDescription() const;
+
+  // Get the interned identity fields (see SymbolTable::identifiers), cheap to compare
+  Symbol getTemotoNamespaceSymbol() const;
+  Symbol getNameSymbol() const;
+  Symbol getTypeSymbol() const;
+  Symbol getPackageNameSymbol() const;
+  Symbol getExecutableSymbol() const;
 
   // Get reliability
   float getReliability() const;
@@ -101,6 +118,23 @@ public:
   // Get advertised
   bool getAdvertised() const;
 
+  /**
+   * @brief Hash of the identity of the component, i.e., the temoto namespace, package name,
+   * executable and the types of input and output topics. Kept up to date by the setters
+   */
+  uint64_t getIdentityHash() const;
+
+  /**
+   * @brief Checks if both components have the same identity (see #getIdentityHash)
+   */
+  bool hasSameIdentity(const ComponentInfo& other) const;
+
+  /**
+   * @brief Launch plan of a local component (see LaunchPlan), computed by the registry. NULL if
+   * it is not computed yet. The setters that affect the plan reset it
+   */
+  const std::shared_ptr<const LaunchPlan>& getLaunchPlan() const;
+
 
   /* * * * * * * * * * * *
    *     SETTERS
@@ -130,90 +164,83 @@ public:
 
   void resetReliability(float reliability);
 
+  void setLaunchPlan(std::shared_ptr<const LaunchPlan> launch_plan);
+
 
 private:
-  
-  std::string temoto_namespace_;
-  std::string component_name_;
-  std::string component_type_;
-  std::string package_name_;
-  std::string executable_;
+
+  void updateIdentityHash();
+
+  InternedString temoto_namespace_;
+  InternedString component_name_;
+  InternedString component_type_;
+  InternedString package_name_;
+  InternedString executable_;
   std::string description_;
   temoto_core::Reliability reliability_;
   temoto_core::TopicContainer input_topics_;
   temoto_core::TopicContainer output_topics_;
   temoto_core::TopicContainer required_parameters_;
+  SymbolMask input_topic_types_;
+  SymbolMask output_topic_types_;
+  SymbolMask required_parameter_types_;
+
+  // Sorted types of the input and output topics, duplicates included. Part of the identity
+  std::vector<Symbol> input_topic_type_list_;
+  std::vector<Symbol> output_topic_type_list_;
+  uint64_t identity_hash_ = 0;
+
+  std::shared_ptr<const LaunchPlan> launch_plan_;
+
   bool advertised_ = false;
 };
 
 typedef std::shared_ptr<ComponentInfo> ComponentInfoPtr;
 typedef std::vector<ComponentInfoPtr> ComponentInfoPtrs;
 
+/// Immutable component info, shared between the registry, query results and allocations
+typedef std::shared_ptr<const ComponentInfo> ComponentInfoConstPtr;
+typedef std::vector<ComponentInfoConstPtr> ComponentInfoConstPtrs;
+
 // TODO: Not sure how to declare operators in a header, implement them in src
 //       and not brake everything (linking problems in places where
 //       component_info.cpp has to be linked)
 static bool operator==(const ComponentInfo& ci1, const ComponentInfo& ci2)
 {
-  // Check the namespace, executable and name of the package
-  if (ci1.getTemotoNamespace() != ci2.getTemotoNamespace() ||
-      ci1.getExecutable() != ci2.getExecutable() ||
-      ci1.getPackageName() != ci2.getPackageName())
+  return ci1.hasSameIdentity(ci2);
+}
+
+/// Hashes components by their identity, so that they can be deduplicated in unordered containers
+struct ComponentInfoIdentityHash
+{
+  std::size_t operator()(const ComponentInfo& ci) const
   {
-    return false;
+    return ci.getIdentityHash();
   }
 
-  // Check the size of input and output topics
-  if (ci1.getInputTopics().size() != ci2.getInputTopics().size() ||
-      ci1.getOutputTopics().size() != ci2.getOutputTopics().size())
+  std::size_t operator()(const ComponentInfoConstPtr& ci) const
   {
-    return false;
+    return ci->getIdentityHash();
   }
+};
 
-  // Check the input topics
-  auto input_topics_2_copy = ci2.getInputTopics();
-  for (auto& input_topic_1 : ci1.getInputTopics())
+/// Compares components by their identity, see ComponentInfoIdentityHash
+struct ComponentInfoIdentityEqual
+{
+  bool operator()(const ComponentInfo& ci1, const ComponentInfo& ci2) const
   {
-    bool topic_found = false;
-    for (auto it=input_topics_2_copy.begin(); it!=input_topics_2_copy.end(); it++)
-    {
-      if (input_topic_1.first == it->first)
-      {
-        topic_found = true;
-        input_topics_2_copy.erase(it);
-        break;
-      }
-    }
-
-    if (!topic_found)
-    {
-      return false;
-    }
+    return ci1.hasSameIdentity(ci2);
   }
 
-  // Check the output topics
-  auto output_topics_2_copy = ci2.getOutputTopics();
-  for (auto& output_topic_1 : ci1.getOutputTopics())
+  bool operator()(const ComponentInfoConstPtr& ci1, const ComponentInfoConstPtr& ci2) const
   {
-    bool topic_found = false;
-    for (auto it=output_topics_2_copy.begin(); it!=output_topics_2_copy.end(); it++)
-    {
-      if (output_topic_1.first == it->first)
-      {
-        topic_found = true;
-        output_topics_2_copy.erase(it);
-        break;
-      }
-    }
-
-    if (!topic_found)
-    {
-      return false;
-    }
+    return ci1->hasSameIdentity(*ci2);
   }
+};
+
+typedef std::unordered_set<ComponentInfo, ComponentInfoIdentityHash, ComponentInfoIdentityEqual> ComponentInfoSet;
+typedef std::unordered_set<ComponentInfoConstPtr, ComponentInfoIdentityHash, ComponentInfoIdentityEqual> ComponentInfoConstPtrSet;
 
-  // The component infos are equal
-  return true;
-}
 } // namespace temoto_component_manager
 
 namespace YAML
@@ -0,0 +1,125 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Author: Robert Valner */
+
+#ifndef TEMOTO_COMPONENT_MANAGER__COMPONENT_INFO_INDEX_H
+#define TEMOTO_COMPONENT_MANAGER__COMPONENT_INFO_INDEX_H
+
+#include "temoto_component_manager/component_info.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+namespace temoto_component_manager
+{
+
+/**
+ * @brief Holds a set of component info objects and maintains secondary indexes (by type,
+ * by name, by package+executable and by temoto namespace) so that lookups touch only the
+ * components which share the requested key. The components are immutable and shared, so
+ * copying the index does not copy the components.
+ */
+class ComponentInfoIndex
+{
+public:
+
+  /// Positions of the components (in #getComponents) that share a key, ordered by decreasing
+  /// reliability. Equally reliable components are kept in the order they were (re)indexed
+  typedef std::vector<std::size_t> Bucket;
+
+  /**
+   * @brief Returns all components in the order they were added
+   */
+  const ComponentInfoConstPtrs& getComponents() const;
+
+  /**
+   * @brief Returns the component that is equal to \p ci (see operator== of ComponentInfo)
+   * @param ci Component to look for
+   * @return The stored component or NULL if such component is not indexed
+   */
+  ComponentInfoConstPtr find(const ComponentInfo& ci) const;
+
+  /**
+   * @brief Adds a component to the index
+   * @param ci
+   * @return false if such component already exists
+   */
+  bool add(ComponentInfoConstPtr ci);
+
+  /**
+   * @brief Replaces an existing component and reindexes it. This is how reliability changes
+   * reach the index, the component is moved to its new place in the reliability order
+   * @param ci
+   * @param advertised
+   * @return false if no such component was found
+   */
+  bool update(const ComponentInfo& ci, bool advertised);
+
+  /**
+   * @brief Removes a component from the index. The last component takes the place of the
+   * removed one, hence the order of #getComponents is not preserved
+   * @param ci
+   * @return false if no such component was found
+   */
+  bool remove(const ComponentInfo& ci);
+
+  /*
+   * Bucket getters. The keys are symbols of SymbolTable::identifiers(). Each returns NULL
+   * if there are no components with the given key
+   */
+  const Bucket* findByType(Symbol component_type) const;
+
+  const Bucket* findByName(Symbol component_name) const;
+
+  const Bucket* findByPackageExecutable(Symbol package_name, Symbol executable) const;
+
+  const Bucket* findByNamespace(Symbol temoto_namespace) const;
+
+  /**
+   * @brief Combines the package and the executable symbols into a single hash key
+   */
+  static uint64_t packageExecutableKey(Symbol package_name, Symbol executable);
+
+private:
+
+  typedef std::unordered_map<uint64_t, Bucket> BucketMap;
+
+  static const Bucket* findBucket(const BucketMap& buckets, uint64_t key);
+
+  static void eraseFromBucket(BucketMap& buckets, uint64_t key, std::size_t position);
+
+  void insertIntoBucket(Bucket& bucket, std::size_t position) const;
+
+  int findPosition(const ComponentInfo& ci) const;
+
+  void insertIntoBuckets(std::size_t position);
+
+  void eraseFromBuckets(std::size_t position);
+
+  ComponentInfoConstPtrs components_;
+
+  BucketMap by_type_;
+  BucketMap by_name_;
+  BucketMap by_package_executable_;
+  BucketMap by_namespace_;
+};
+
+} // component_manager namespace
+
+#endif
@@ -21,14 +21,27 @@
 
 #include "temoto_core/common/base_subsystem.h"
 #include "temoto_component_manager/component_info.h"
+#include "temoto_component_manager/component_info_index.h"
 #include "temoto_component_manager/pipe_info.h"
+#include "temoto_component_manager/pipe_catalog.h"
+#include "temoto_component_manager/mpsc_queue.h"
 #include "temoto_component_manager/LoadComponent.h"
 #include "temoto_component_manager/LoadPipe.h"
 #include "temoto_core/common/temoto_id.h"
 
 #include <vector>
+#include <map>
+#include <set>
 #include <mutex>
 #include <thread>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <cstdint>
 
 namespace temoto_component_manager
 {
@@ -45,38 +58,210 @@ public:
     std::vector<ComponentInfoPtr>& components;
   };
 
+  /// Remote components partitioned by the temoto namespace of the manager that advertised them
+  typedef std::map<std::string, std::shared_ptr<const ComponentInfoIndex>> RemotePartitions;
+
+  /**
+   * @brief Immutable, versioned view of the registry contents. Writers never modify a published
+   * snapshot, they build a new version and swap it in, hence readers can use the snapshot without
+   * locking for as long as they hold the pointer.
+   */
+  struct Snapshot
+  {
+    /// Incremented every time a new snapshot is published
+    uint64_t version = 0;
+
+    /// All locally defined components
+    std::shared_ptr<const ComponentInfoIndex> local_components;
+
+    /// All components in remote managers
+    std::shared_ptr<const RemotePartitions> remote_components;
+
+    /// Categorized pipes, each category is ordered by decreasing reliability
+    std::shared_ptr<const PipeCatalog> pipes;
+  };
+
+  typedef std::shared_ptr<const Snapshot> SnapshotPtr;
+
+  /**
+   * @brief Entry of the change log. The generation equals the version of the snapshot
+   * that the change was published in
+   */
+  struct ComponentChange
+  {
+    enum Kind
+    {
+      ADDED,
+      UPDATED,
+      REMOVED
+    };
+
+    uint64_t generation;
+    Kind kind;
+
+    /// true if the component is local, false if it is a remote component
+    bool local;
+
+    /// State of the component after the change (or before it, if the component was removed)
+    ComponentInfoConstPtr component;
+  };
+
+  /**
+   * @brief Counters of the LoadComponent query cache
+   */
+  struct QueryCacheStats
+  {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    std::size_t entries = 0;
+  };
+
   ComponentInfoRegistry(temoto_core::BaseSubsystem* b);
 
-  bool findLocalComponents( temoto_component_manager::LoadComponent::Request& req, std::vector<ComponentInfo>& ci_ret ) const;
+  bool findLocalComponents( temoto_component_manager::LoadComponent::Request& req, ComponentInfoConstPtrs& ci_ret ) const;
 
-  bool findLocalComponent( const ComponentInfo& ci, ComponentInfo& ci_ret ) const;
+  bool findLocalComponent( const ComponentInfo& ci, ComponentInfoConstPtr& ci_ret ) const;
 
   bool findLocalComponent( const ComponentInfo& ci ) const;
 
-  bool findRemoteComponents( temoto_component_manager::LoadComponent::Request& req, std::vector<ComponentInfo>& ci_ret ) const;
+  bool findRemoteComponents( temoto_component_manager::LoadComponent::Request& req, ComponentInfoConstPtrs& ci_ret ) const;
 
-  bool findRemoteComponent( const ComponentInfo& ci, ComponentInfo& ci_ret ) const;
+  bool findRemoteComponent( const ComponentInfo& ci, ComponentInfoConstPtr& ci_ret ) const;
 
   bool findRemoteComponent( const ComponentInfo& ci ) const;
 
+  /**
+   * @brief Builds the query cache key out of the fields that affect the result of #findComponents.
+   * The topic and parameter types are sorted, since their order does not affect the result.
+   * Requests with equal keys get the same candidates from the same snapshot
+   */
+  static std::string queryCacheKey(const temoto_component_manager::LoadComponent::Request& req, bool local);
+
   bool addLocalComponent( const ComponentInfo& ci );
 
+  /**
+   * @brief Adds a batch of local components in one go, i.e., publishes one new snapshot.
+   * Meant for the workspace scans, which would otherwise copy the index once per component
+   * @return Number of components that did not exist yet and were added
+   */
+  unsigned int addLocalComponents( const std::vector<ComponentInfo>& cis );
+
   bool addRemoteComponent( const ComponentInfo& ci );
 
   bool updateLocalComponent(const ComponentInfo& ci, bool advertised = false);
 
   bool updateRemoteComponent(const ComponentInfo& ci, bool advertised = false);
 
-  const std::vector<ComponentInfo>& getLocalComponents() const;
+  /**
+   * @brief Updates a batch of local components in one go, i.e., publishes one new snapshot
+   * @return Number of components that were found and updated
+   */
+  unsigned int updateLocalComponents(const std::vector<ComponentInfo>& cis, bool advertised = false);
+
+  bool removeLocalComponent(const ComponentInfo& ci);
+
+  bool removeRemoteComponent(const ComponentInfo& ci);
+
+  /**
+   * @brief Adds or updates a batch of components advertised by a remote manager. Only the
+   * partition of the given namespace is touched and one new snapshot is published
+   * 
+   * @param temoto_namespace Namespace of the remote manager
+   * @param components Advertised components, their namespace is set to \p temoto_namespace
+   */
+  void mergeRemoteComponents(const std::string& temoto_namespace, const std::vector<ComponentInfo>& components);
+
+  /**
+   * @brief Atomically replaces all components of a remote manager, e.g., on a full advertisement.
+   * Components that are not in \p components are removed
+   * 
+   * @param temoto_namespace Namespace of the remote manager
+   * @param components Advertised components, their namespace is set to \p temoto_namespace
+   */
+  void replaceRemoteComponents(const std::string& temoto_namespace, const std::vector<ComponentInfo>& components);
+
+  /**
+   * @brief Drops all components of a remote manager
+   * @return false if there were no components from the given namespace
+   */
+  bool removeRemoteNamespace(const std::string& temoto_namespace);
+
+  /**
+   * @brief Returns the component changes that were made after the given generation, oldest first.
+   * Runs in time proportional to the number of returned changes
+   * 
+   * @param generation Generation (snapshot version) that the caller is up to date with
+   * @param changes Changes with a greater generation than \p generation
+   * @return false if the change log no longer holds all changes since \p generation. In that case
+   * the caller has to resynchronize from #getSnapshot, the log holds all changes up to the version
+   * of any snapshot that the caller gets
+   */
+  bool getChangesSince(uint64_t generation, std::vector<ComponentChange>& changes) const;
+
+  QueryCacheStats getQueryCacheStats() const;
 
-  const std::vector<ComponentInfo>& getRemoteComponents() const;
+  /**
+   * @brief Restores the local components and the pipes from a snapshot file (see
+   * RegistrySnapshotFile), so that requests can be answered before the workspace is scanned.
+   * The restored entries are refreshed or dropped by #reconcileRestoredComponents and
+   * #reconcileRestoredPipes once the workspace scan has confirmed or ruled them out
+   * 
+   * @param path Path to the snapshot file
+   * @return false if there was no valid snapshot at \p path
+   */
+  bool restoreSnapshot(const std::string& path);
 
-  const std::map<std::string, PipeInfos>& getPipes() const;
+  /**
+   * @brief Starts a background thread that writes the local components and the pipes to a
+   * snapshot file whenever they have changed
+   * 
+   * @param path Path to the snapshot file
+   */
+  void startPersisting(const std::string& path);
 
-  bool findPipes( const LoadPipe::Request& req, PipeInfos& pipes_ret ) const;
+  /**
+   * @brief Reconciles the components restored by #restoreSnapshot with a workspace scan. The
+   * restored components that were scanned are confirmed and replaced by the scanned descriptors.
+   * The rest are removed if the scan was complete and kept for the next scan otherwise
+   * 
+   * @param scanned_components Components found by the scan
+   * @param scan_complete false if some descriptors could not be read, i.e., a restored component
+   * that was not scanned might still exist
+   */
+  void reconcileRestoredComponents(const std::vector<ComponentInfo>& scanned_components, bool scan_complete);
+
+  /**
+   * @brief Same as #reconcileRestoredComponents but for the pipes restored by #restoreSnapshot
+   * 
+   * @param scanned_pipes Pipes found by the scan
+   * @param scan_complete false if some descriptors could not be read
+   */
+  void reconcileRestoredPipes(const PipeInfos& scanned_pipes, bool scan_complete);
+
+  /**
+   * @brief Returns the latest published snapshot of the registry. Does not lock.
+   */
+  SnapshotPtr getSnapshot() const;
+
+  /**
+   * @brief Finds the pipes of the requested category that provide the requested output topics.
+   * Pipes with a specified segment (see LoadPipe::Request::pipe_segment_specifiers) that no known
+   * component can serve are left out, so that none of their segments gets launched in vain
+   * 
+   * @param req
+   * @param pipes_ret Suitable pipes, the most reliable first
+   * @return false if no pipe was suitable
+   */
+  bool findPipes( const LoadPipe::Request& req, PipeInfoConstPtrs& pipes_ret ) const;
 
   bool addPipe( const PipeInfo& pi);
 
+  /**
+   * @brief Adds a batch of pipes in one go, i.e., publishes one new snapshot
+   * @return Number of pipes that did not exist yet and were added
+   */
+  unsigned int addPipes( const PipeInfos& pis );
+
   bool updatePipe( const PipeInfo& pi );
 
   /**
@@ -84,16 +269,18 @@ public:
    * 
    * @param cir_update_callback 
    */
-  void registerUpdateCallback( std::function<void(ComponentInfo)> cir_update_callback);
+  void registerUpdateCallback( std::function<void(ComponentInfoConstPtr)> cir_update_callback);
 
   /**
-   * @brief Calls all registered cir update callbacks
+   * @brief Queues an update event for the registered cir update callbacks. The callbacks are
+   * invoked asynchronously by a fixed pool of worker threads. Pending events that concern the same
+   * component type are coalesced, i.e., only the most reliable component of a burst is delivered
    * 
    * @param ci Copy of the added/updated component 
-   * @return true if all callbacks were invoked successfully
-   * @return false if a callback failed
+   * @return true if the event was queued
+   * @return false if there are no callbacks to invoke
    */
-  bool callUpdateCallbacks(ComponentInfo ci);
+  bool callUpdateCallbacks(ComponentInfoConstPtr ci);
 
   /**
    * @brief Destroy the Component Info Registry object
@@ -103,6 +290,39 @@ public:
 
 private:
 
+  /**
+   * @brief Requested topic types (or parameter keys) in a form that can be tested against
+   * the precomputed symbol masks of the components
+   */
+  struct KeyRequirement
+  {
+    KeyRequirement(const std::vector<diagnostic_msgs::KeyValue>& keys);
+
+    /// The requested keys
+    const std::vector<diagnostic_msgs::KeyValue>& keys_;
+
+    /// Symbols of the requested keys
+    SymbolMask mask_;
+
+    /// False if some of the keys is not interned, i.e., no component can satisfy the requirement
+    bool satisfiable_ = true;
+
+    /// True if some key is requested more than once, in that case the mask alone is not sufficient
+    bool has_duplicates_ = false;
+  };
+
+  /**
+   * @brief Checks if a component satisfies the requirement
+   * 
+   * @param requirement Requested keys
+   * @param types Symbol mask of the component
+   * @param topics Topics (or parameters) of the component
+   * @return true if the requirement is satisfied
+   */
+  bool satisfies( const KeyRequirement& requirement
+                , const SymbolMask& types
+                , const std::vector<temoto_core::StringPair>& topics ) const;
+
   /**
    * @brief 
    * 
@@ -118,68 +338,228 @@ private:
    * @brief Returns a vector of components that follow the requested criteria
    * 
    * @param req Requested component
-   * @param components Vector of known components
+   * @param components Indexed set of known components
    * @param ci_ret Vector of found components
    * @return true Found component(s)
    * @return false Did not find any components
    */
   bool findComponents( temoto_component_manager::LoadComponent::Request& req
-                     , const std::vector<ComponentInfo>& components
-                     , std::vector<ComponentInfo>& ci_ret ) const;
+                     , const ComponentInfoIndex& components
+                     , ComponentInfoConstPtrs& ci_ret ) const;
+
+  /**
+   * @brief Same as #findComponents but the ranked candidate lists are cached per request. A cached
+   * list stays valid until a local (or remote, respectively) component of the requested type changes
+   * 
+   * @param req Requested component
+   * @param local Look for local components if true, remote components otherwise
+   * @param ci_ret Vector of found components
+   */
+  bool findComponentsCached( temoto_component_manager::LoadComponent::Request& req
+                           , bool local
+                           , ComponentInfoConstPtrs& ci_ret ) const;
+
+  /**
+   * @brief Invalidates the cached queries of the given component type and marks the type for
+   * #refreshPipeFeasibility. Must be called after the change is published, with #write_mutex_ locked
+   * 
+   * @param affects_feasibility false if the change cannot make a pipe segment of this type
+   * (in)feasible, e.g. only the reliability of a component has changed
+   */
+  void invalidateQueryCache(bool local, Symbol component_type, bool affects_feasibility = true);
+
+  /**
+   * @brief Returns a copy of the local component with its launch plan computed, unless it already has one
+   */
+  static ComponentInfo withLaunchPlan(const ComponentInfo& ci);
+
+  /**
+   * @brief Describes a segment of the pipe as a component request, the same way as loadPipeCb
+   * describes it when it loads the segment. Only the topic types are filled in
+   */
+  static LoadComponent::Request segmentRequest(const PipeInfo& pipe, unsigned int segment_index);
+
+  /**
+   * @brief Checks if each segment of the pipe can be served by a local or a remote component
+   */
+  bool isPipeFeasible(const PipeInfo& pipe) const;
+
+  /**
+   * @brief Reevaluates the feasibility of the pipes that have segments of the component types that
+   * changed since the last call and publishes the pipes if any flag changed. Must be called with
+   * #write_mutex_ locked
+   */
+  void refreshPipeFeasibility();
 
   /**
    * @brief Returns one component that matches the requested criteria the most
    * 
    * @param ci Requested component
-   * @param components Vector of known components
+   * @param components Indexed set of known components
    * @param ci_ret Found component
    * @return true If found a component
    * @return false if component was not found
    */
   bool findComponent( const ComponentInfo& ci
-                    , const std::vector<ComponentInfo>& components
-                    , ComponentInfo& ci_ret ) const;
+                    , const ComponentInfoIndex& components
+                    , ComponentInfoConstPtr& ci_ret ) const;
 
   /**
-   * @brief 
-   * 
-   * @param pi 
-   * @param pi_ret 
-   * @return PipeInfo* 
+   * @brief Checks if the last segment of the pipe at the given position of the catalog provides
+   * only topic types that are among the required ones
+   * @param required_types Interned types of the required output topics
+   */
+  static bool providesOutputTopics( const PipeCatalog& pipes
+                                  , std::size_t position
+                                  , const SymbolMask& required_types );
+
+  /**
+   * @brief Checks if each segment of the pipe that is specified in the request can be served by
+   * a local or a remote component. The segments are described the same way as loadPipeCb
+   * describes them when it loads the segments
+   */
+  bool satisfiesSegmentSpecifiers( const PipeInfo& pipe, const LoadPipe::Request& req ) const;
+
+  /// Component changes of a single generation, see ComponentChange
+  typedef std::vector<std::pair<ComponentChange::Kind, ComponentInfoConstPtr>> Changes;
+
+  /**
+   * @brief Publishes a new version of the registry. Parts that are NULL are shared
+   * with the current snapshot. The changes are appended to the change log atomically with
+   * the publication, they concern local components if \p local_components is given and remote
+   * components otherwise. The oldest entries are dropped if the log is full.
+   * Must be called with #write_mutex_ locked.
+   * @return Version of the published snapshot
+   */
+  uint64_t publishSnapshot( std::shared_ptr<const ComponentInfoIndex> local_components
+                          , std::shared_ptr<const RemotePartitions> remote_components
+                          , std::shared_ptr<const PipeCatalog> pipes
+                          , const Changes& changes = Changes() );
+
+  /**
+   * @brief Returns the partition of remote components of the given namespace or NULL if there is none
+   */
+  static const ComponentInfoIndex* findRemotePartition( const Snapshot& snapshot
+                                                      , const std::string& temoto_namespace );
+
+  /**
+   * @brief Returns a copy of the remote partitions where the partition of the given namespace is
+   * replaced. An empty partition is dropped. Only the partition pointers are copied
+   */
+  static std::shared_ptr<const RemotePartitions> replaceRemotePartition( const Snapshot& snapshot
+                                                                       , const std::string& temoto_namespace
+                                                                       , std::shared_ptr<const ComponentInfoIndex> partition );
+
+  /**
+   * @brief Moves the queued update events to #pending_updates_, coalescing them by component type
+   */
+  void updateDispatcherLoop();
+
+  /**
+   * @brief Invokes the update callbacks for the pending updates
    */
-  PipeInfo* findPipe ( const PipeInfo& pi );
+  void updateWorkerLoop();
 
-  void updateCallbackCleanupLoop();
+  /**
+   * @brief Writes the snapshot file whenever the local components or the pipes have changed
+   */
+  void persistLoop(std::string path);
+
+  /// Number of threads that invoke the update callbacks
+  static const unsigned int UPDATE_WORKER_COUNT = 2;
 
   /// Update callback
-  std::vector<std::function<void(ComponentInfo)>> cir_update_callbacks_;
+  std::vector<std::function<void(ComponentInfoConstPtr)>> cir_update_callbacks_;
+
+  std::mutex cir_update_callbacks_mutex_;
+
+  /// Added/updated components. The writers push without locking, only the dispatcher pops
+  MpscQueue<ComponentInfoConstPtr> update_events_;
+
+  /// Guards #update_events_pending_. The writers set the flag and notify with it locked, after
+  /// their push, so that the dispatcher cannot miss a wakeup
+  std::mutex update_events_mutex_;
+  std::condition_variable update_events_cv_;
+
+  /// Set when an event is pushed, cleared by the dispatcher before it drains the queue
+  bool update_events_pending_ = false;
+
+  /// Coalesced updates (component type -> most reliable component) waiting for a worker
+  std::map<Symbol, ComponentInfoConstPtr> pending_updates_;
+
+  /// Order in which the types in #pending_updates_ are served
+  std::deque<Symbol> pending_update_order_;
 
-  /// Threads where the callbacks are run
-  std::vector<std::thread> cir_update_callback_threads_;
+  std::mutex pending_updates_mutex_;
+  std::condition_variable pending_updates_cv_;
 
-  mutable std::recursive_mutex cir_cb_update_mutex_;
+  std::thread update_dispatcher_thread_;
 
-  std::thread update_callback_cleanup_thread_;
+  std::vector<std::thread> update_worker_threads_;
 
-  bool stop_cleanup_loop_ = false;
+  std::atomic<bool> stop_update_threads_;
 
-  /// List of all locally defined components.
-  std::vector<ComponentInfo> local_components_;
+  /// Maximum number of entries kept in #change_log_
+  static const std::size_t CHANGE_LOG_CAPACITY = 4096;
 
-  /// List of all components in remote managers.
-  std::vector<ComponentInfo> remote_components_;
+  /// Most recent component changes, ordered by generation
+  std::deque<ComponentChange> change_log_;
 
-  /// List of categorized pipes
-  std::map<std::string, PipeInfos> categorized_pipes_;
+  /// Generation of the newest change that has been dropped from #change_log_
+  uint64_t change_log_truncated_generation_ = 0;
+
+  mutable std::mutex change_log_mutex_;
+
+  /**
+   * @brief Cached result of a LoadComponent query
+   */
+  struct QueryCacheEntry
+  {
+    /// Generation of the component type when the query was resolved
+    uint64_t type_generation;
+
+    /// Candidates in decreasing order of reliability, empty if none were found
+    std::shared_ptr<const ComponentInfoConstPtrs> candidates;
+  };
+
+  /// Maximum number of cached queries, the cache is cleared once it is exceeded
+  static const std::size_t QUERY_CACHE_CAPACITY = 1024;
+
+  mutable std::unordered_map<std::string, QueryCacheEntry> query_cache_;
+
+  /// Incremented every time a component of a type changes. Keyed by the type symbol, the
+  /// remote types are offset by 2^32
+  std::unordered_map<uint64_t, uint64_t> type_generations_;
+
+  mutable QueryCacheStats query_cache_stats_;
+
+  mutable std::mutex query_cache_mutex_;
+
+  /// Restored entries that have been neither confirmed nor ruled out by a workspace scan yet,
+  /// guarded by #write_mutex_
+  std::vector<ComponentInfo> restored_components_;
+  PipeInfos restored_pipes_;
+
+  /// Component types whose changes have not reached the pipe feasibility flags yet, guarded by #write_mutex_
+  std::set<Symbol> stale_segment_types_;
+
+  std::thread persist_thread_;
+
+  std::mutex persist_mutex_;
+  std::condition_variable persist_cv_;
+  bool stop_persisting_ = false;
+
+  /// Set when the local components or the pipes have changed since they were last written
+  bool persist_pending_ = false;
+
+  /// Latest published snapshot, accessed only via std::atomic_load/std::atomic_store
+  SnapshotPtr snapshot_;
 
   /// Responsible for grenerating uniquie pipe_info ids
   temoto_core::temoto_id::IDManager pipe_info_id_manager_;
 
-  /// Mutex for protecting component info vectors from data races
-  mutable std::recursive_mutex read_write_mutex;
-
-  /// Mutex for protecting pipe info vectors from data races
-  mutable std::recursive_mutex read_write_mutex_pipe_;
+  /// Serializes the writers, readers use #snapshot_ without locking
+  std::mutex write_mutex_;
 };
 
 } // component_manager namespace
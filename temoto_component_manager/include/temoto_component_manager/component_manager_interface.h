@@ -335,6 +335,125 @@ public:
     stopComponent(req);
   }
 
+  /**
+   * @brief Invokes several components with a single request. The components are launched
+   * concurrently by the Component Manager
+   * 
+   * @param components requested components, the fields have the same meaning as in the LoadComponent request
+   * @param temoto_namespace namespace of the Component Manager that loads the components
+   * @return std::vector<ComponentResult> One result per requested component, in the same order.
+   * A component that could not be loaded has its success flag unset and an error message.
+   * The batch is not recovered automatically when one of its components fails, since the other
+   * components keep running. Register a batch status callback to restart the failed components
+   */
+  std::vector<ComponentResult> startComponents( const std::vector<ComponentRequest>& components
+                                              , std::string temoto_namespace = "")
+  {
+    try
+    {
+      validateInterface();
+    }
+    catch (temoto_core::error::ErrorStack& error_stack)
+    {
+      throw FORWARD_ERROR(error_stack);
+    }
+
+    LoadComponents load_components_msg;
+    load_components_msg.request.components = components;
+    return startComponents(load_components_msg, temoto_namespace);
+  }
+
+  std::vector<ComponentResult> startComponents( LoadComponents& load_components_srv_msg
+                                              , std::string temoto_namespace = "")
+  {
+    #ifdef enable_tracing
+    std::unique_ptr<opentracing::Span> tracing_span;
+
+    if (resource_registrar_->statusCallbackActive())
+    {
+      temoto_core::StringMap parent_context = resource_registrar_->getStatusCallbackSpanContext();
+      TextMapCarrier carrier(parent_context);
+      auto span_context_maybe = TRACER->Extract(carrier);
+      tracing_span = TRACER->StartSpan(this->class_name_ + "::" + __func__, {opentracing::ChildOf(span_context_maybe->get())});
+    }
+    else
+    {
+      tracing_span = TRACER->StartSpan(this->class_name_ + "::" + __func__);
+    }
+    #endif
+
+    if(temoto_namespace.empty())
+    {
+      temoto_namespace = temoto_core::common::getTemotoNamespace();
+    }
+
+    // Call the server
+    try
+    {
+      #ifdef enable_tracing
+      temoto_core::StringMap local_span_context;
+      TextMapCarrier carrier(local_span_context);
+      auto err = TRACER->Inject(tracing_span->context(), carrier);
+
+      resource_registrar_->template call<LoadComponents>( srv_name::MANAGER_2
+      , srv_name::BATCH_SERVER
+      , load_components_srv_msg
+      , temoto_core::trr::FailureBehavior::NONE
+      , temoto_namespace
+      , local_span_context);
+
+      #else
+      // If tracing is not enabled
+      resource_registrar_->template call<LoadComponents>( srv_name::MANAGER_2
+      , srv_name::BATCH_SERVER
+      , load_components_srv_msg
+      , temoto_core::trr::FailureBehavior::NONE
+      , temoto_namespace);
+
+      #endif
+    }
+    catch(temoto_core::error::ErrorStack& error_stack)
+    {
+      throw FORWARD_ERROR(error_stack);
+    }
+
+    allocated_component_batches_.push_back(load_components_srv_msg);
+    return load_components_srv_msg.response.components;
+  }
+
+  /**
+   * @brief Stops all components that were started by the given startComponents request
+   * 
+   * @param load_components_msg 
+   */
+  void stopComponents(const temoto_component_manager::LoadComponents& load_components_msg)
+  {
+    auto found_batch_it = std::find_if(
+        allocated_component_batches_.begin(),
+        allocated_component_batches_.end(),
+        [&](const LoadComponents& srv_msg) -> bool
+        {
+          return srv_msg.response.trr.resource_id == load_components_msg.response.trr.resource_id;
+        });
+
+    if (found_batch_it == allocated_component_batches_.end())
+    {
+      throw CREATE_ERROR(temoto_core::error::Code::RESOURCE_UNLOAD_FAIL, "Unable to unload resource that is not "
+                                                            "loaded.");
+    }
+
+    try
+    {
+      // do the unloading
+      resource_registrar_->unloadClientResource(found_batch_it->response.trr.resource_id);
+      allocated_component_batches_.erase(found_batch_it);
+    }
+    catch (temoto_core::error::ErrorStack& error_stack)
+    {
+      throw FORWARD_ERROR(error_stack);
+    }
+  }
+
   /**
    * @brief Invokes a pipe
    * 
@@ -533,6 +652,18 @@ public:
     component_update_callback_ = callback;
   }
 
+  /**
+   * @brief Registers a custom recovery routine for the components started by startComponents.
+   * The failure status refers to the whole batch, so the routine has to restart the components
+   * that are not running, e.g. with startComponent on the topics in ComponentResult
+   * 
+   * @param callback 
+   */
+  void registerComponentBatchStatusCallback( void (ParentSubsystem::*callback )(const LoadComponents&))
+  {
+    component_batch_status_callback_ = callback;
+  }
+
   /**
    * @brief Registers a custom pipe recovery routine
    * 
@@ -565,9 +696,11 @@ public:
 private:
   std::vector<LoadComponent> allocated_components_;
   std::vector<LoadPipe> allocated_pipes_;
+  std::vector<LoadComponents> allocated_component_batches_;
 
   void(ParentSubsystem::*component_status_callback_)(const LoadComponent&) = NULL;
   void(ParentSubsystem::*component_update_callback_)(const LoadComponent&) = NULL;
+  void(ParentSubsystem::*component_batch_status_callback_)(const LoadComponents&) = NULL;
   void(ParentSubsystem::*pipe_status_callback_)(const LoadPipe&) = NULL;
   void(ParentSubsystem::*pipe_update_callback_)(const LoadPipe&) = NULL;
 
@@ -712,6 +845,40 @@ private:
         }
       }
 
+      /*
+       * Check if the resource that failed was a batch of components
+       */
+      auto batch_it = std::find_if(
+        allocated_component_batches_.begin(),
+        allocated_component_batches_.end(),
+        [&](const LoadComponents& batch) -> bool {
+          return batch.response.trr.resource_id == srv.request.resource_id;
+        });
+
+      if (batch_it != allocated_component_batches_.end())
+      {
+        if (srv.request.status_code == temoto_core::trr::status_codes::FAILED)
+        {
+          /*
+           * The status does not say which component of the batch failed, and the others are still
+           * running, so the batch is neither unloaded nor requested again
+           */
+          if (component_batch_status_callback_)
+          {
+            TEMOTO_WARN_STREAM("Executing a custom component batch recovery behaviour defined in parent_subsystem '"
+              << parent_subsystem_pointer_->class_name_ << "'.");
+            LoadComponents load_components_msg_cpy = *batch_it;
+            (parent_subsystem_pointer_->*component_batch_status_callback_)(load_components_msg_cpy);
+          }
+          else
+          {
+            TEMOTO_WARN_STREAM("A component of the batch has failed. Register a component batch status "
+              "callback to restart it.");
+          }
+        }
+        return;
+      }
+
       TEMOTO_ERROR_STREAM("Resource status arrived for a resource that does not exist.");
       // throw CREATE_ERROR(temoto_core::error::Code::RESOURCE_NOT_FOUND, "Resource status arrived for a "
       //                    "resource that does not exist.");
@@ -24,9 +24,17 @@
 #include "temoto_core/trr/resource_registrar.h"
 #include "temoto_component_manager/component_info_registry.h"
 #include "temoto_component_manager/component_manager_services.h"
+#include "temoto_component_manager/warm_pool.h"
+#include "temoto_component_manager/allocation_tracker.h"
+#include "temoto_component_manager/topic_relay.h"
+#include "temoto_component_manager/launch_plan.h"
 #include "temoto_er_manager/temoto_er_manager_services.h"
+#include "ros/callback_queue.h"
 #include "std_msgs/String.h"
+#include <map>
 #include <mutex>
+#include <condition_variable>
+#include <future>
 
 namespace temoto_component_manager
 {
@@ -63,7 +71,7 @@ public:
    * 
    * @param test 
    */
-  void cirUpdateCallback(ComponentInfo component);
+  void cirUpdateCallback(ComponentInfoConstPtr component);
     
 private:
 
@@ -78,6 +86,111 @@ private:
    */
   void loadComponentCb(LoadComponent::Request& req, LoadComponent::Response& res);
 
+  /**
+   * @brief Serves a LoadComponent request by the given candidates, which have been resolved
+   * against the registry by the caller
+   * @param l_cis Local candidates, the most reliable first
+   * @param r_cis Remote candidates, the most reliable first
+   */
+  void loadResolvedComponent( LoadComponent::Request& req
+                            , LoadComponent::Response& res
+                            , const ComponentInfoConstPtrs& l_cis
+                            , const ComponentInfoConstPtrs& r_cis);
+
+  /**
+   * @brief Candidates that #loadComponentsCb has resolved for one of its components. Handed over
+   * to the #loadComponentCb that serves the component, so that it is not resolved twice
+   */
+  struct ResolvedComponent
+  {
+    uint64_t token;
+    ComponentInfoConstPtrs local_candidates;
+    ComponentInfoConstPtrs remote_candidates;
+  };
+
+  /**
+   * @brief Takes the resolved candidates of a request that is equivalent to \p req (see
+   * ComponentInfoRegistry::queryCacheKey)
+   * @return false if no batch has resolved such request
+   */
+  bool takeResolvedComponent(const LoadComponent::Request& req, ResolvedComponent& resolved);
+
+  /**
+   * @brief Returns the topics of a running component to the client. The topics that the client
+   * asked to be remapped are relayed in-process on behalf of the allocation of this request
+   * @param alloc_comp_response Response that the component was launched with
+   */
+  void connectToRunningComponent( LoadComponent::Request& req
+                                , LoadComponent::Response& res
+                                , const LoadComponent::Response& alloc_comp_response);
+
+  /**
+   * @brief Serves the request by an idle pre-launched instance of one of the candidates
+   * @return false if the warm pool had no suitable instance
+   */
+  bool serveFromWarmPool( LoadComponent::Request& req
+                        , LoadComponent::Response& res
+                        , const ComponentInfoConstPtrs& candidates);
+
+  /**
+   * @brief Releases the reference that the warm pool holds on an instance
+   */
+  void releaseWarmInstance(const WarmPool::Instance& instance);
+
+  /**
+   * @brief Stops the pre-launched instances of the types that went cold and launches the
+   * instances of the hot types
+   */
+  void warmPoolTimerCb(const ros::TimerEvent& e);
+
+  /**
+   * @brief Fills out the response with the loaded local component, increases its reliability
+   * and registers it as allocated
+   */
+  void registerLocalComponent( const ComponentInfo& ci
+                             , LoadComponent::Response& res
+                             , const temoto_er_manager::LoadExtResource& load_er_msg);
+
+  /**
+   * @brief Decreases the reliability of a local component that failed to launch, unless the
+   * External Resource Manager itself could not be reached
+   */
+  void handleLocalComponentFailure(const ComponentInfo& ci, temoto_core::error::ErrorStack& error_stack);
+
+  /// Launch of a single local candidate in the hedged mode
+  struct HedgedLaunch
+  {
+    ComponentInfoConstPtr candidate;
+    LoadComponent::Response res;
+    temoto_er_manager::LoadExtResource load_er_msg;
+    std::future<void> launch;
+    bool finished = false;
+  };
+
+  /// Wakes up #launchHedged whenever one of its launches has finished, successfully or not
+  struct HedgedLaunchSignal
+  {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<HedgedLaunch*> finished;
+  };
+
+  std::shared_ptr<HedgedLaunch> startHedgedLaunch( LoadComponent::Request& req
+                                                 , const LoadComponent::Response& res
+                                                 , const ComponentInfoConstPtr& candidate
+                                                 , std::shared_ptr<HedgedLaunchSignal> signal);
+
+  /**
+   * @brief Launches the candidates in the order of their reliability, starting the next one
+   * whenever the previous ones have failed or have not finished within the hedge delay. The
+   * first successful candidate is kept and the others are unloaded
+   * @param candidates Local candidates, the most reliable first
+   * @return false if all candidates failed
+   */
+  bool launchHedged( LoadComponent::Request& req
+                   , LoadComponent::Response& res
+                   , const ComponentInfoConstPtrs& candidates);
+
   /**
    * @brief Called when a component is unloaded.
    * @param req
@@ -93,6 +206,42 @@ private:
    */
   void loadPipeCb(LoadPipe::Request& req, LoadPipe::Response& res);
 
+  /**
+   * @brief Builds the LoadComponent request of the i-th segment of the pipe
+   * @param previous_segment_topics Output topics of the preceding segment
+   */
+  LoadComponent makeSegmentRequest( const LoadPipe::Request& req
+                                  , const LoadPipe::Response& res
+                                  , const PipeInfo& pipe
+                                  , unsigned int i
+                                  , const temoto_core::TopicContainer& previous_segment_topics) const;
+
+  /**
+   * @brief Launches the segments one after another, each segment is connected to the topics
+   * that the preceding one reported
+   * @param sub_resource_ids Resource ids of the launched segments, also when an error is thrown
+   */
+  void bringUpSegmentsSequentially( const LoadPipe::Request& req
+                                  , LoadPipe::Response& res
+                                  , const PipeInfo& pipe
+                                  , std::vector<int>& sub_resource_ids);
+
+  /**
+   * @brief Launches all segments at once, connecting them by the topic names that the pipe
+   * assigns to its segments
+   * @param sub_resource_ids Resource ids of the launched segments, also when an error is thrown
+   * @return false, with nothing left running, if a segment did not accept the assigned topic names
+   */
+  bool bringUpSegmentsConcurrently( const LoadPipe::Request& req
+                                  , LoadPipe::Response& res
+                                  , const PipeInfo& pipe
+                                  , std::vector<int>& sub_resource_ids);
+
+  /**
+   * @brief Unloads the given segments of a pipe, the last launched first
+   */
+  void rollBackSegments(const std::vector<int>& sub_resource_ids);
+
   /**
    * @brief Callback for pipe unloading routines
    * 
@@ -101,6 +250,25 @@ private:
    */
   void unloadPipeCb(LoadPipe::Request& req, LoadPipe::Response& res);
 
+  /**
+   * @brief Callback to the batch loading service. All components are resolved against the
+   * registry first, the ones that have candidates are then requested via #resource_registrar_2_
+   * by up to #batch_thread_count_ threads. The resolved candidates are handed over to
+   * #loadComponentCb through #resolved_components_. The failures are reported per component
+   * 
+   * @param req 
+   * @param res 
+   */
+  void loadComponentsCb(LoadComponents::Request& req, LoadComponents::Response& res);
+
+  /**
+   * @brief Called when a batch is unloaded. Its components are unloaded by the resource registrar
+   * 
+   * @param req 
+   * @param res 
+   */
+  void unloadComponentsCb(LoadComponents::Request& req, LoadComponents::Response& res);
+
   /**
    * @brief Called when component status update information is received.
    * @param srv
@@ -126,23 +294,25 @@ private:
   void processTopics( std::vector<diagnostic_msgs::KeyValue>& req_topics
                     , std::vector<diagnostic_msgs::KeyValue>& res_topics
                     , temoto_er_manager::LoadExtResource& load_er_msg
-                    , ComponentInfo& component_info
+                    , const ComponentInfo& component_info
                     , std::string direction);
 
   void processParameters( std::vector<diagnostic_msgs::KeyValue>& req_parameters
                         , std::vector<diagnostic_msgs::KeyValue>& res_parameters
                         , temoto_er_manager::LoadExtResource& load_er_msg
-                        , ComponentInfo& component_info);
+                        , const ComponentInfo& component_info);
 
   /**
-   * @brief Checks if given component is already in use
-   * 
-   * @param ci_to_check 
-   * @return temoto_core::temoto_id::ID 
+   * @brief Returns the launch plan that the registry computed for the component, or computes it
    */
-  temoto_core::temoto_id::ID checkIfInUse( const std::vector<ComponentInfo>& cis_to_check) const;
+  static LaunchPlanConstPtr getLaunchPlan(const ComponentInfo& component_info);
 
   ros::NodeHandle nh_;
+
+  /// The list services are served on their own queue, so that these are answered while
+  /// components are being loaded. Served by #list_spinner_
+  ros::CallbackQueue list_queue_;
+  ros::NodeHandle list_nh_;
   ros::ServiceServer list_components_server_;
   ros::ServiceServer list_pipes_server_;
 
@@ -158,23 +328,52 @@ private:
    */
   temoto_core::trr::ResourceRegistrar<ComponentManagerServers> resource_registrar_2_;
 
-  /// Generates unique id's for the pipes
+  /// Generates unique id's for the pipes. Shared by concurrent loads
   temoto_core::temoto_id::IDManager pipe_id_generator_;
+  std::mutex pipe_id_generator_mutex_;
+
+  /// Launch the segments of a pipe in parallel, set by the "~concurrent_pipe_bringup" parameter
+  bool concurrent_pipe_bringup_;
+
+  /// Number of the most reliable local candidates that are raced in the hedged launch mode,
+  /// set by the "~hedged_launch_candidates" parameter. Values below 2 disable the mode
+  int hedged_launch_candidates_;
+
+  /// Seconds after which the next candidate is started, set by the "~hedged_launch_delay" parameter
+  double hedged_launch_delay_;
+
+  /// Request statistics and pre-launched components, configured by the "~warm_pool" parameters
+  WarmPool warm_pool_;
+  ros::Timer warm_pool_timer_;
 
   /*
-   * TODO: A DATA STRUCTURE THAT IS A TEMPORARY HACK UNTIL RMP IS IMPROVED
+   * Allocated components and pipes. The component infos are shared with the registry. The
+   * tracker has a lock of its own, which is never held while a resource is requested or a
+   * status is sent.
+   *
+   * TODO: THE PIPE ALLOCATIONS ARE A TEMPORARY HACK UNTIL RMP IS IMPROVED
    */
-  typedef std::map<temoto_core::temoto_id::ID, std::pair<PipeInfo, std::vector<int>>> AllocatedPipes;
-  AllocatedPipes allocated_pipes_hack_;
-  mutable std::recursive_mutex allocated_pipes_mutex_;
+  AllocationTracker allocations_;
+
+  /// Topic relays of the allocated components that are reused with other topic names
+  TopicRelayEngine topic_relays_;
+
+  /// Components resolved by the batches in progress, by the query key of their requests
+  std::multimap<std::string, ResolvedComponent> resolved_components_;
+  uint64_t next_resolved_token_ = 0;
+  std::mutex resolved_components_mutex_;
+
+  /// Maximum number of components of a batch that are loaded at a time, set by the
+  /// "~threads/batch" parameter
+  int batch_thread_count_;
 
-  /// List of allocated components
-  typedef std::pair<ComponentInfo, LoadComponent::Response> ComponentInfoResponse;
-  std::map<temoto_core::temoto_id::ID, ComponentInfoResponse> allocated_components_;
-  mutable std::recursive_mutex allocated_components_mutex_;
+  /// Number of threads is set by the "~threads/list" parameter
+  ros::AsyncSpinner list_spinner_;
 
-  std::map<temoto_core::temoto_id::ID, temoto_er_manager::LoadExtResource> allocated_ext_resources_;
-  mutable std::recursive_mutex allocated_ext_resources_mutex_;
+  /// Unloading of the candidates that lost a hedged launch. Declared last, so that these are
+  /// waited for before the rest of the members are destroyed
+  std::vector<std::future<void>> hedged_cleanups_;
+  std::mutex hedged_cleanups_mutex_;
 
 }; // ComponentManagerServers
 
@@ -24,6 +24,7 @@
 #include "temoto_component_manager/ListComponents.h"
 #include "temoto_component_manager/ListPipes.h"
 #include "temoto_component_manager/LoadComponent.h"
+#include "temoto_component_manager/LoadComponents.h"
 #include "temoto_component_manager/LoadPipe.h"
 #include "temoto_component_manager/Component.h"
 #include "temoto_component_manager/Pipe.h"
@@ -39,6 +40,7 @@ namespace temoto_component_manager
 
     const std::string MANAGER_2 = "component_manager_pipe";
     const std::string PIPE_SERVER = "load_pipe";
+    const std::string BATCH_SERVER = "load_components";
 
     const std::string LIST_COMPONENTS_SERVER = "list_components_server";
     const std::string LIST_PIPES_SERVER = "list_pipes_server";
@@ -25,6 +25,7 @@
 #include "temoto_action_engine/action_engine.h"
 
 #include "ros/ros.h"
+#include "ros/callback_queue.h"
 #include "std_msgs/String.h"
 
 namespace temoto_component_manager
@@ -82,12 +83,20 @@ private:
 
   /**
    * @brief A callback function that is called when other instance of temoto has advertised
-   * its components.
+   * its components. The message is handed over to #snooper_queue_ and processed by #processSync.
    * @param msg Incoming message
    * @param payload Data portion of the message
    */
   void syncCb(const temoto_core::ConfigSync& msg, const PayloadType& payload);
 
+  /**
+   * @brief Advertises the local components or updates the remote components, depending on
+   * the synchronization message.
+   * @param msg Incoming message
+   * @param payload Data portion of the message
+   */
+  void processSync(const temoto_core::ConfigSync& msg, const PayloadType& payload);
+
   /**
    * @brief A timer event callback function which checks if local component info entries have been
    * updated and if so, then advertises local components via #advertiseComponent.
@@ -95,6 +104,10 @@ private:
    */
   void updateMonitoringTimerCb(const ros::TimerEvent &e);
 
+  /// Queue of the timer and the synchronization messages, so that these do not wait for the
+  /// component loads. Served by #snooper_spinner_
+  ros::CallbackQueue snooper_queue_;
+
   /// NodeHandle for the timer
   ros::NodeHandle nh_;
 
@@ -114,6 +127,13 @@ private:
    */
   ros::Timer update_monitoring_timer_;
 
+  /// Registry generation up to which the local component changes have been checked
+  uint64_t checked_generation_ = 0;
+
+  /// Number of threads is set by the "~threads/sync" parameter. Declared last, so that the
+  /// threads are stopped before the rest of the members are destroyed
+  ros::AsyncSpinner snooper_spinner_;
+
 };
 
 } // component_manager namespace
@@ -0,0 +1,109 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Author: Robert Valner */
+
+#ifndef TEMOTO_COMPONENT_MANAGER__LAUNCH_PLAN_H
+#define TEMOTO_COMPONENT_MANAGER__LAUNCH_PLAN_H
+
+#include "temoto_component_manager/component_info.h"
+#include "diagnostic_msgs/KeyValue.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace temoto_component_manager
+{
+
+/**
+ * @brief The request independent part of launching a local component: the kind of the
+ * executable, the default topics and parameters as they are returned to the client, and the
+ * remapping arguments of the default parameters. The registry computes it once per component,
+ * hence a load request only fills in the remaps it asks for.
+ */
+class LaunchPlan
+{
+public:
+
+  explicit LaunchPlan(const ComponentInfo& ci);
+
+  /// Topics of a launch file are remapped by their type, topics of an executable by their name
+  bool isLaunchFile() const
+  {
+    return is_launch_file_;
+  }
+
+  /// Default input topics with absolute names
+  const std::vector<diagnostic_msgs::KeyValue>& getInputTopics() const
+  {
+    return input_topics_;
+  }
+
+  /// Default output topics with absolute names
+  const std::vector<diagnostic_msgs::KeyValue>& getOutputTopics() const
+  {
+    return output_topics_;
+  }
+
+  /// Default values of the required parameters
+  const std::vector<diagnostic_msgs::KeyValue>& getParameters() const
+  {
+    return parameters_;
+  }
+
+  /// Remapping arguments that set all parameters to their default values
+  const std::string& getDefaultParameterArgs() const
+  {
+    return default_parameter_args_;
+  }
+
+  /*
+   * Slot getters. Return the position of the first topic or parameter of the given type in the
+   * respective vector, or -1 if the component has no such topic or parameter
+   */
+  int findInputTopic(const std::string& topic_type) const;
+
+  int findOutputTopic(const std::string& topic_type) const;
+
+  int findParameter(const std::string& parameter) const;
+
+private:
+
+  typedef std::unordered_map<std::string, int> SlotMap;
+
+  static void fill( const std::vector<temoto_core::StringPair>& pairs
+                  , bool absolute
+                  , std::vector<diagnostic_msgs::KeyValue>& key_values
+                  , SlotMap& slots);
+
+  static int findSlot(const SlotMap& slots, const std::string& key);
+
+  bool is_launch_file_;
+  std::vector<diagnostic_msgs::KeyValue> input_topics_;
+  std::vector<diagnostic_msgs::KeyValue> output_topics_;
+  std::vector<diagnostic_msgs::KeyValue> parameters_;
+  SlotMap input_topic_slots_;
+  SlotMap output_topic_slots_;
+  SlotMap parameter_slots_;
+  std::string default_parameter_args_;
+};
+
+typedef std::shared_ptr<const LaunchPlan> LaunchPlanConstPtr;
+
+} // component_manager namespace
+
+#endif
@@ -0,0 +1,113 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Author: Robert Valner */
+
+#ifndef TEMOTO_COMPONENT_MANAGER__MPSC_QUEUE_H
+#define TEMOTO_COMPONENT_MANAGER__MPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+
+namespace temoto_component_manager
+{
+
+/**
+ * @brief Unbounded lock-free multi-producer single-consumer queue (Vyukov's intrusive queue
+ * with heap allocated nodes). Any thread may push, only one thread at a time may pop.
+ * A push never blocks on other producers nor on the consumer.
+ * 
+ * @tparam T Value type, must be default constructible (used for the stub node)
+ */
+template <typename T>
+class MpscQueue
+{
+public:
+
+  MpscQueue()
+  : head_(new Node())
+  , tail_(head_.load())
+  {}
+
+  MpscQueue(const MpscQueue&) = delete;
+
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  ~MpscQueue()
+  {
+    T value;
+    while (pop(value))
+    {}
+    delete tail_;
+  }
+
+  /**
+   * @brief Appends a value to the queue. Safe to call from any thread
+   */
+  void push(T value)
+  {
+    Node* node = new Node(std::move(value));
+    Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next_.store(node, std::memory_order_release);
+  }
+
+  /**
+   * @brief Takes the oldest value out of the queue. Must be called only by the consumer thread
+   * 
+   * @param value Set to the popped value
+   * @return false if the queue was empty (or a producer has not finished linking its node yet)
+   */
+  bool pop(T& value)
+  {
+    Node* tail = tail_;
+    Node* next = tail->next_.load(std::memory_order_acquire);
+    if (next == nullptr)
+    {
+      return false;
+    }
+    value = std::move(next->value_);
+    tail_ = next;
+    delete tail;
+    return true;
+  }
+
+private:
+
+  struct Node
+  {
+    Node()
+    : next_(nullptr)
+    {}
+
+    explicit Node(T&& value)
+    : value_(std::move(value))
+    , next_(nullptr)
+    {}
+
+    T value_;
+    std::atomic<Node*> next_;
+  };
+
+  /// Most recently pushed node, shared by the producers
+  std::atomic<Node*> head_;
+
+  /// Stub node whose successor is the next value to pop, owned by the consumer
+  Node* tail_;
+};
+
+} // component_manager namespace
+
+#endif
@@ -0,0 +1,177 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Author: Robert Valner */
+
+#ifndef TEMOTO_COMPONENT_MANAGER__PIPE_CATALOG_H
+#define TEMOTO_COMPONENT_MANAGER__PIPE_CATALOG_H
+
+#include "temoto_component_manager/pipe_info.h"
+#include "temoto_component_manager/symbol_table.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <cstdint>
+
+namespace temoto_component_manager
+{
+
+/**
+ * @brief Holds the known pipes and indexes them by category, by name, by segment type, by the
+ * output topic types of the pipe and by the contents of the pipe. The output topic types of the last segment of each pipe are
+ * interned up front, so that the output topic requirements of a request are checked without
+ * touching the strings.
+ * The pipes are immutable and shared, so copying the catalog does not copy the pipes.
+ */
+class PipeCatalog
+{
+public:
+
+  /// Positions of the pipes (in #getPipes) of a category, ordered by decreasing reliability.
+  /// Equally reliable pipes are kept in the order they were (re)indexed
+  typedef std::vector<std::size_t> Bucket;
+
+  /**
+   * @brief Returns all pipes in the order they were added
+   */
+  const PipeInfoConstPtrs& getPipes() const;
+
+  /**
+   * @brief Returns the categories and their pipes
+   */
+  const std::map<std::string, Bucket>& getCategories() const;
+
+  /**
+   * @brief Returns the pipes of the given category or NULL if there are none
+   */
+  const Bucket* findByCategory(const std::string& category) const;
+
+  /**
+   * @brief Returns the position (in #getPipes) of the pipe with the given name or -1 if there is none
+   */
+  int findByName(const std::string& name) const;
+
+  /**
+   * @brief Returns the pipes that have at least one segment of the given type or NULL if there are none
+   * @param segment_type Symbol of SymbolTable::identifiers()
+   */
+  const Bucket* findBySegmentType(Symbol segment_type) const;
+
+  /**
+   * @brief Collects the pipes of the given category whose last segment provides no output topic
+   * types other than the given ones, plus some pipes that do (all that provide at least one
+   * of the given types). The result is ordered like the category (see #findByCategory)
+   * 
+   * @param category
+   * @param topic_types Symbols of SymbolTable::keys()
+   * @param candidates Positions (in #getPipes) of the candidate pipes
+   * @return false if the category has no such pipes
+   */
+  bool findByOutputTopicTypes( const std::string& category
+                             , const std::vector<Symbol>& topic_types
+                             , Bucket& candidates ) const;
+
+  /**
+   * @brief Returns the pipe that is equal to \p pi (see operator== of PipeInfo)
+   * @param pi Pipe to look for
+   * @return The stored pipe or NULL if such pipe is not in the catalog
+   */
+  PipeInfoConstPtr find(const PipeInfo& pi) const;
+
+  /**
+   * @brief Returns the interned output topic types of the last segment of the pipe at the given position
+   */
+  const SymbolMask& getOutputTopicTypes(std::size_t position) const;
+
+  /**
+   * @brief Returns whether each segment of the pipe at the given position can be served by a
+   * known component. The flag is maintained by the owner of the catalog, a new pipe is not feasible
+   */
+  bool isFeasible(std::size_t position) const;
+
+  void setFeasible(std::size_t position, bool feasible);
+
+  /**
+   * @brief Adds a pipe to the catalog
+   * @param pi
+   * @return false if such pipe already exists
+   */
+  bool add(PipeInfoConstPtr pi);
+
+  /**
+   * @brief Replaces an existing pipe. This is how reliability changes reach the catalog, the
+   * pipe is moved to its new place in the reliability order of its category. The feasibility
+   * is kept, as the segments stay the same
+   * @param pi
+   * @return false if no such pipe was found
+   */
+  bool update(PipeInfoConstPtr pi);
+
+  /**
+   * @brief Removes a pipe from the catalog. The last pipe takes the place of the removed one,
+   * hence the order of #getPipes is not preserved
+   * @param pi
+   * @return false if no such pipe was found
+   */
+  bool remove(const PipeInfo& pi);
+
+private:
+
+  static uint64_t contentHash(const PipeInfo& pi);
+
+  static std::vector<Symbol> segmentTypes(const PipeInfo& pi);
+
+  int findPosition(const PipeInfo& pi) const;
+
+  /**
+   * @brief Inserts the position after all pipes in the bucket that are at least as reliable
+   */
+  void insertByReliability(Bucket& bucket, std::size_t position) const;
+
+  static void eraseFromBucket(Bucket& bucket, std::size_t position);
+
+  void insertIntoIndexes(std::size_t position);
+
+  void eraseFromIndexes(std::size_t position);
+
+  PipeInfoConstPtrs pipes_;
+
+  // Indexed by the position of the pipe
+  std::vector<SymbolMask> output_topic_types_;
+  std::vector<uint64_t> content_hashes_;
+  std::vector<bool> feasible_;
+
+  /// Tells the order in which the pipes were (re)indexed, which breaks the reliability ties
+  std::vector<uint64_t> index_sequences_;
+  uint64_t next_index_sequence_ = 0;
+
+  std::map<std::string, Bucket> by_category_;
+  std::unordered_map<std::string, std::size_t> by_name_;
+  std::unordered_map<Symbol, Bucket> by_segment_type_;
+
+  /// Pipes by category and output topic type of the last segment, ordered like the category
+  std::map<std::pair<std::string, Symbol>, Bucket> by_output_topic_type_;
+
+  /// Pipes by category whose last segment provides no output topics, ordered like the category
+  std::map<std::string, Bucket> without_output_topics_;
+  std::unordered_map<uint64_t, Bucket> by_content_;
+};
+
+} // component_manager namespace
+
+#endif
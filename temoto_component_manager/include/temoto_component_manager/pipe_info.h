@@ -21,6 +21,7 @@
 
 #include "temoto_core/common/temoto_log_macros.h"
 #include "temoto_core/common/reliability.h"
+#include "temoto_component_manager/symbol_table.h"
 
 #include <string>
 #include <vector>
@@ -44,31 +45,31 @@ enum class SegmentCategory : int
 };
 
 /**
- * @brief The Segment struct
+ * @brief The Segment struct. The topic types and the parameters are symbols of SymbolTable::keys()
  */
 struct Segment
 {
-  std::string segment_type_;                          // Camera ... or ARtag detector ...
-  std::set<std::string> required_input_topic_types_;  // The types of the topics that this segment requires
-  std::set<std::string> required_output_topic_types_; // The types of the topics that this segment must publish
-  std::set<std::string> required_parameters_;         // The types of parameters this segment requires
+  std::string segment_type_;              // Camera ... or ARtag detector ...
+  SymbolSet required_input_topic_types_;  // The types of the topics that this segment requires
+  SymbolSet required_output_topic_types_; // The types of the topics that this segment must publish
+  SymbolSet required_parameters_;         // The types of parameters this segment requires
 
   /// add input topic type
-  void addInputTopicType(std::string topic_type)
+  void addInputTopicType(const std::string& topic_type)
   {
-    required_input_topic_types_.insert(topic_type);
+    required_input_topic_types_.insert(SymbolTable::keys().intern(topic_type));
   }
 
   /// add output topic type
-  void addOutputTopicType(std::string topic_type)
+  void addOutputTopicType(const std::string& topic_type)
   {
-    required_output_topic_types_.insert(topic_type);
+    required_output_topic_types_.insert(SymbolTable::keys().intern(topic_type));
   }
 
   /// add output topic type
-  void addRequiredParameter(std::string required_parameter)
+  void addRequiredParameter(const std::string& required_parameter)
   {
-    required_parameters_.insert(required_parameter);
+    required_parameters_.insert(SymbolTable::keys().intern(required_parameter));
   }
 
   /// to string
@@ -83,7 +84,7 @@ struct Segment
       str += "| |_required input topic types: ";
       for (auto& topic : required_input_topic_types_)
       {
-        str += topic;
+        str += SymbolTable::keys().str(topic);
         if (topic != *std::prev(required_input_topic_types_.end()))
         {
           str += ", ";
@@ -98,7 +99,7 @@ struct Segment
       str += "| |_required output topic types: ";
       for (auto& topic : required_output_topic_types_)
       {
-        str += topic;
+        str += SymbolTable::keys().str(topic);
         if (topic != *std::prev(required_output_topic_types_.end()))
         {
           str += ", ";
@@ -262,6 +263,16 @@ typedef std::shared_ptr<PipeInfo> PipeInfoPtr;
  */
 typedef std::vector<PipeInfoPtr> PipeInfoPtrs;
 
+/**
+ * @brief Immutable pipe info, shared between the registry, query results and allocations
+ */
+typedef std::shared_ptr<const PipeInfo> PipeInfoConstPtr;
+
+/**
+ * @brief PipeInfoConstPtrs
+ */
+typedef std::vector<PipeInfoConstPtr> PipeInfoConstPtrs;
+
 } // namespace temoto_component_manager
 
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
@@ -290,7 +301,7 @@ struct convert<temoto_component_manager::PipeInfo>
       {
         for (auto& topic_type : segment.required_input_topic_types_)
         {
-          segment_node["input_topic_types"].push_back(topic_type);
+          segment_node["input_topic_types"].push_back(temoto_component_manager::SymbolTable::keys().str(topic_type));
         }
       }
 
@@ -299,7 +310,7 @@ struct convert<temoto_component_manager::PipeInfo>
       {
         for (auto& topic_type : segment.required_output_topic_types_)
         {
-          segment_node["output_topic_types"].push_back(topic_type);
+          segment_node["output_topic_types"].push_back(temoto_component_manager::SymbolTable::keys().str(topic_type));
         }
       }
 
@@ -308,7 +319,7 @@ struct convert<temoto_component_manager::PipeInfo>
       {
         for (auto& parameter : segment.required_parameters_)
         {
-          segment_node["required_parameters"].push_back(parameter);
+          segment_node["required_parameters"].push_back(temoto_component_manager::SymbolTable::keys().str(parameter));
         }
       }
 
@@ -0,0 +1,69 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Author: Robert Valner */
+
+#ifndef TEMOTO_COMPONENT_MANAGER__REGISTRY_SNAPSHOT_H
+#define TEMOTO_COMPONENT_MANAGER__REGISTRY_SNAPSHOT_H
+
+#include "temoto_component_manager/component_info.h"
+#include "temoto_component_manager/pipe_info.h"
+
+#include <string>
+#include <vector>
+
+namespace temoto_component_manager
+{
+
+/**
+ * @brief Reads and writes a binary image of the local registry contents (components, pipes and
+ * their reliabilities), so that a restarted manager can answer requests before the workspace
+ * has been scanned again.
+ * 
+ * The file starts with a magic number and a format version, followed by the components and the
+ * pipes. Strings are stored as a 32 bit length and the characters. A file with an unknown format
+ * is ignored.
+ */
+class RegistrySnapshotFile
+{
+public:
+
+  /**
+   * @brief Writes the snapshot to a temporary file and renames it over \p path, hence a reader
+   * never sees a partially written snapshot. The file and its directory are synced to disk
+   * 
+   * @return false if the file could not be written or synced
+   */
+  static bool write( const std::string& path
+                   , const ComponentInfoConstPtrs& components
+                   , const PipeInfoConstPtrs& pipes );
+
+  /**
+   * @brief Memory-maps and parses the snapshot
+   * 
+   * @param path
+   * @param components Restored components
+   * @param pipes Restored pipes
+   * @return false if the file does not exist or is not a valid snapshot
+   */
+  static bool read( const std::string& path
+                  , std::vector<ComponentInfo>& components
+                  , PipeInfos& pipes );
+};
+
+} // component_manager namespace
+
+#endif
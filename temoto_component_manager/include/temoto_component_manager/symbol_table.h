@@ -0,0 +1,217 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Author: Robert Valner */
+
+#ifndef TEMOTO_COMPONENT_MANAGER__SYMBOL_TABLE_H
+#define TEMOTO_COMPONENT_MANAGER__SYMBOL_TABLE_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+namespace temoto_component_manager
+{
+
+/// Integer identifier of an interned string
+typedef uint32_t Symbol;
+
+/**
+ * @brief Handle of an interned string. Copying and comparing it is as cheap as for an integer.
+ * Handles are comparable only if they originate from the same SymbolTable.
+ */
+class InternedString
+{
+public:
+
+  /// Empty string, which is interned as symbol 0 in every table
+  InternedString();
+
+  Symbol symbol() const
+  {
+    return symbol_;
+  }
+
+  const std::string& str() const
+  {
+    return *str_;
+  }
+
+  bool operator==(const InternedString& other) const
+  {
+    return symbol_ == other.symbol_;
+  }
+
+  bool operator!=(const InternedString& other) const
+  {
+    return symbol_ != other.symbol_;
+  }
+
+private:
+
+  friend class SymbolTable;
+
+  InternedString(Symbol symbol, const std::string* str);
+
+  Symbol symbol_;
+  const std::string* str_;
+};
+
+/**
+ * @brief Thread safe table of interned strings. Each distinct string gets a dense integer
+ * identifier which stays valid for the lifetime of the process. The empty string is always
+ * interned as symbol 0.
+ */
+class SymbolTable
+{
+public:
+
+  SymbolTable();
+
+  /**
+   * @brief Returns the symbol of the string, creates a new symbol if the string is not interned yet
+   */
+  Symbol intern(const std::string& str);
+
+  /**
+   * @brief Same as #intern but returns a handle which also gives lock-free access to the string
+   */
+  InternedString internString(const std::string& str);
+
+  /**
+   * @brief Looks up the symbol of the string without interning it
+   * @return false if the string is not interned
+   */
+  bool find(const std::string& str, Symbol& symbol) const;
+
+  /**
+   * @brief Returns the string of the symbol. The reference stays valid for the lifetime of the table
+   */
+  const std::string& str(Symbol symbol) const;
+
+  /**
+   * @brief Process-wide table of topic types and parameter keys
+   */
+  static SymbolTable& keys();
+
+  /**
+   * @brief Process-wide table of identifiers, i.e., names, types, packages, executables
+   * and namespaces of the components
+   */
+  static SymbolTable& identifiers();
+
+private:
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Symbol> symbols_;
+
+  /// Deque does not relocate its elements, hence references to the strings stay valid
+  std::deque<std::string> strings_;
+};
+
+/**
+ * @brief Set of symbols stored as a bitset, indexed by the symbol
+ */
+class SymbolMask
+{
+public:
+
+  void insert(Symbol symbol);
+
+  bool contains(Symbol symbol) const;
+
+  bool empty() const;
+
+  /**
+   * @brief Checks if all symbols of this set are contained in the \p other set
+   */
+  bool isSubsetOf(const SymbolMask& other) const;
+
+private:
+
+  std::vector<uint64_t> words_;
+};
+
+/**
+ * @brief Sorted set of symbols stored as a flat array. Up to #INLINE_CAPACITY symbols are kept
+ * inline, hence the typical sets of a few topic types do not allocate and compare as plain arrays.
+ * The order is the order of the symbols, not of the interned strings
+ */
+class SymbolSet
+{
+public:
+
+  typedef const Symbol* const_iterator;
+
+  static const std::size_t INLINE_CAPACITY = 4;
+
+  SymbolSet();
+
+  /**
+   * @brief Inserts the symbol unless it is already contained
+   * @return false if the symbol was already contained
+   */
+  bool insert(Symbol symbol);
+
+  bool contains(Symbol symbol) const;
+
+  std::size_t size() const
+  {
+    return size_;
+  }
+
+  bool empty() const
+  {
+    return size_ == 0;
+  }
+
+  const_iterator begin() const
+  {
+    return data();
+  }
+
+  const_iterator end() const
+  {
+    return data() + size_;
+  }
+
+  bool operator==(const SymbolSet& other) const;
+
+  bool operator!=(const SymbolSet& other) const
+  {
+    return !(*this == other);
+  }
+
+private:
+
+  const Symbol* data() const
+  {
+    return (size_ <= INLINE_CAPACITY) ? inline_symbols_ : heap_symbols_.data();
+  }
+
+  std::size_t size_;
+  Symbol inline_symbols_[INLINE_CAPACITY];
+
+  /// Used only when the set does not fit into #inline_symbols_
+  std::vector<Symbol> heap_symbols_;
+};
+
+} // component_manager namespace
+
+#endif
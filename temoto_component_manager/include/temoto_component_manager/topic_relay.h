@@ -0,0 +1,124 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Author: Robert Valner */
+
+#ifndef TEMOTO_COMPONENT_MANAGER__TOPIC_RELAY_H
+#define TEMOTO_COMPONENT_MANAGER__TOPIC_RELAY_H
+
+#include "temoto_core/common/temoto_id.h"
+#include "ros/ros.h"
+#include "topic_tools/shape_shifter.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+
+namespace temoto_component_manager
+{
+
+/**
+ * @brief Forwards the messages of one topic to another topic within this process. The messages
+ * are passed on in their serialized form, hence any message type can be relayed without
+ * deserializing it. The target topic is advertised when the first message arrives, as only
+ * then the type of the messages is known.
+ */
+class TopicRelay
+{
+public:
+
+  TopicRelay(const std::string& source_topic, const std::string& target_topic);
+
+  /**
+   * @brief Subscribes to the source topic. The subscription keeps only a weak reference to
+   * the relay, so destroying the relay stops it even if a message is being relayed
+   */
+  static void start(const boost::shared_ptr<TopicRelay>& relay);
+
+  const std::string& getSourceTopic() const
+  {
+    return source_topic_;
+  }
+
+  const std::string& getTargetTopic() const
+  {
+    return target_topic_;
+  }
+
+private:
+
+  void relayCb(const ros::MessageEvent<topic_tools::ShapeShifter const>& msg_event);
+
+  ros::NodeHandle nh_;
+  std::string source_topic_;
+  std::string target_topic_;
+  ros::Subscriber subscriber_;
+  ros::Publisher publisher_;
+  bool advertised_;
+};
+
+/**
+ * @brief Keeps the in-process topic relays of the allocated components. Allocations that ask
+ * for the same remap share one relay, which is stopped when the last of them is released.
+ */
+class TopicRelayEngine
+{
+public:
+
+  /**
+   * @brief Starts relaying \p source_topic to \p target_topic on behalf of an allocation, or
+   * adds the allocation to the users of the existing relay
+   * @param owner Resource id of the allocation
+   */
+  void addRelay( temoto_core::temoto_id::ID owner
+               , const std::string& source_topic
+               , const std::string& target_topic);
+
+  /**
+   * @brief Releases all relays of an allocation, the relays without users are stopped
+   * @param owner Resource id of the allocation
+   */
+  void removeRelays(temoto_core::temoto_id::ID owner);
+
+  /**
+   * @brief Returns the number of running relays
+   */
+  std::size_t getRelayCount() const;
+
+private:
+
+  /// Source and target topic
+  typedef std::pair<std::string, std::string> RelayKey;
+
+  struct SharedRelay
+  {
+    /// roscpp tracks the subscriber objects with boost pointers
+    boost::shared_ptr<TopicRelay> relay;
+    unsigned int use_count;
+  };
+
+  std::map<RelayKey, SharedRelay> relays_;
+
+  /// Relays used by each allocation. An allocation that asks for the same remap twice is listed twice
+  std::map<temoto_core::temoto_id::ID, std::vector<RelayKey>> owner_relays_;
+
+  mutable std::mutex relays_mutex_;
+};
+
+} // component_manager namespace
+
+#endif
@@ -0,0 +1,137 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Author: Robert Valner */
+
+#ifndef TEMOTO_COMPONENT_MANAGER__WARM_POOL_H
+#define TEMOTO_COMPONENT_MANAGER__WARM_POOL_H
+
+#include "temoto_component_manager/component_info.h"
+#include "temoto_component_manager/component_manager_services.h"
+#include "temoto_er_manager/temoto_er_manager_services.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <chrono>
+#include <mutex>
+
+namespace temoto_component_manager
+{
+
+/**
+ * @brief Counts the requests per component type and keeps idle, pre-launched instances of the
+ * frequently requested (hot) types. The pool does not launch anything by itself, it tells the
+ * owner which types to launch and accounts for the memory and CPU that the instances take.
+ */
+class WarmPool
+{
+public:
+
+  struct Config
+  {
+    /// Maximum number of idle instances, 0 disables the pool
+    int size = 0;
+
+    /// Number of requests within #window after which a component type is hot
+    int hot_requests = 3;
+
+    /// Seconds that a request counts towards the statistics
+    double window = 600;
+
+    /// Memory (MB) and CPU (cores) that the idle instances may take on this host, 0 is unlimited
+    double memory_budget_mb = 0;
+    double cpu_budget = 0;
+
+    /// Declared cost of an instance per component type. The "default" entry applies to the
+    /// types that are not listed
+    std::map<std::string, double> memory_mb;
+    std::map<std::string, double> cpu;
+  };
+
+  /**
+   * @brief An idle instance, launched with the default topics and parameters of the component
+   */
+  struct Instance
+  {
+    ComponentInfoConstPtr component;
+    temoto_er_manager::LoadExtResource load_er_msg;
+    LoadComponent::Response res;
+  };
+
+  WarmPool(const Config& config);
+
+  bool enabled() const;
+
+  void recordRequest(const std::string& component_type);
+
+  /**
+   * @brief Returns the hot types that have no idle instance and fit into the size and the
+   * budget of the pool, the most requested first
+   */
+  std::vector<std::string> getTypesToWarm();
+
+  /**
+   * @brief Adds a launched instance to the pool
+   * @return false if the instance does not fit into the pool anymore
+   */
+  bool add(const Instance& instance);
+
+  /**
+   * @brief Takes an idle instance of the first candidate that has one. The component of the
+   * returned instance is replaced by the candidate, which is the current version of it
+   * @param candidates Components that can serve the request, the most preferred first
+   * @param instance Taken instance
+   * @return false if none of the candidates has an idle instance
+   */
+  bool take(const ComponentInfoConstPtrs& candidates, Instance& instance);
+
+  /**
+   * @brief Takes all idle instances of the types that are not hot anymore
+   */
+  std::vector<Instance> takeCold();
+
+private:
+
+  typedef std::chrono::steady_clock Clock;
+
+  static double getCost(const std::map<std::string, double>& costs, const std::string& component_type);
+
+  bool fitsBudget(double memory_mb, double cpu) const;
+
+  /// Forgets the requests that are older than the window. Must be called with #mutex_ locked
+  void pruneRequests();
+
+  bool isHot(const std::string& component_type) const;
+
+  void release(const Instance& instance);
+
+  Config config_;
+
+  /// Times of the recent requests per component type
+  std::map<std::string, std::deque<Clock::time_point>> requests_;
+
+  std::vector<Instance> instances_;
+  double used_memory_mb_;
+  double used_cpu_;
+
+  mutable std::mutex mutex_;
+};
+
+} // component_manager namespace
+
+#endif
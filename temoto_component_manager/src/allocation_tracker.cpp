@@ -0,0 +1,276 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Author: Robert Valner */
+
+#include "temoto_component_manager/allocation_tracker.h"
+#include "temoto_component_manager/component_info_index.h"
+#include <algorithm>
+
+namespace temoto_component_manager
+{
+
+void AllocationTracker::addComponent(ID resource_id, const Component& component)
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = components_.find(resource_id);
+  if (it == components_.end())
+  {
+    components_.emplace(resource_id, component);
+    indexComponent(resource_id, component);
+    return;
+  }
+
+  // Keep the place of the allocation in its buckets if the keys stay the same
+  bool reindex = !hasSameIndexKeys(it->second, component);
+  if (reindex)
+  {
+    unindexComponent(resource_id, it->second);
+  }
+  it->second = component;
+  if (reindex)
+  {
+    indexComponent(resource_id, component);
+  }
+}
+
+bool AllocationTracker::removeComponent(ID resource_id)
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = components_.find(resource_id);
+  if (it == components_.end())
+  {
+    return false;
+  }
+  unindexComponent(resource_id, it->second);
+  components_.erase(it);
+  return true;
+}
+
+bool AllocationTracker::findComponent(ID resource_id, Component& component) const
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = components_.find(resource_id);
+  if (it == components_.end())
+  {
+    return false;
+  }
+  component = it->second;
+  return true;
+}
+
+bool AllocationTracker::updateComponent(ID resource_id, ComponentInfoConstPtr component)
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = components_.find(resource_id);
+  if (it == components_.end())
+  {
+    return false;
+  }
+  /*
+   * Usually only the reliability changes. Then the allocation keeps its place in the buckets,
+   * which are in the order of allocation, so that #findRunningComponent still finds the oldest
+   */
+  Component updated_component = it->second;
+  updated_component.component = std::move(component);
+  if (hasSameIndexKeys(it->second, updated_component))
+  {
+    it->second = std::move(updated_component);
+    return true;
+  }
+
+  unindexComponent(resource_id, it->second);
+  it->second = std::move(updated_component);
+  indexComponent(resource_id, it->second);
+  return true;
+}
+
+bool AllocationTracker::findRunningComponent( const ComponentInfoConstPtrs& candidates
+                                            , ID& resource_id
+                                            , Component& component) const
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (const ComponentInfoConstPtr& candidate : candidates)
+  {
+    auto bucket_it = by_package_executable_.find(ComponentInfoIndex::packageExecutableKey(
+      candidate->getPackageNameSymbol(), candidate->getExecutableSymbol()));
+    if (bucket_it == by_package_executable_.end())
+    {
+      continue;
+    }
+
+    resource_id = bucket_it->second.front();
+    component = components_.at(resource_id);
+    return true;
+  }
+  return false;
+}
+
+std::size_t AllocationTracker::getUseCount(const ComponentInfo& ci) const
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto bucket_it = by_package_executable_.find(ComponentInfoIndex::packageExecutableKey(
+    ci.getPackageNameSymbol(), ci.getExecutableSymbol()));
+  return bucket_it == by_package_executable_.end() ? 0 : bucket_it->second.size();
+}
+
+std::vector<AllocationTracker::ID> AllocationTracker::findLessReliable(const ComponentInfo& ci) const
+{
+  std::vector<ID> resource_ids;
+
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto bucket_it = by_type_.find(ci.getTypeSymbol());
+  if (bucket_it == by_type_.end())
+  {
+    return resource_ids;
+  }
+
+  for (ID resource_id : bucket_it->second)
+  {
+    if (ci.getReliability() > components_.at(resource_id).component->getReliability())
+    {
+      resource_ids.push_back(resource_id);
+    }
+  }
+  return resource_ids;
+}
+
+void AllocationTracker::addPipe(ID resource_id, const Pipe& pipe)
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = pipes_.find(resource_id);
+  if (it != pipes_.end())
+  {
+    unindexPipe(resource_id, it->second);
+    it->second = pipe;
+  }
+  else
+  {
+    pipes_.emplace(resource_id, pipe);
+  }
+
+  for (int sub_resource_id : pipe.sub_resource_ids)
+  {
+    by_segment_[sub_resource_id].push_back(resource_id);
+  }
+}
+
+bool AllocationTracker::removePipe(ID resource_id)
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = pipes_.find(resource_id);
+  if (it == pipes_.end())
+  {
+    return false;
+  }
+  unindexPipe(resource_id, it->second);
+  pipes_.erase(it);
+  return true;
+}
+
+bool AllocationTracker::findPipeBySegment(int sub_resource_id, ID& resource_id, Pipe& pipe) const
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto bucket_it = by_segment_.find(sub_resource_id);
+  if (bucket_it == by_segment_.end())
+  {
+    return false;
+  }
+  resource_id = bucket_it->second.front();
+  pipe = pipes_.at(resource_id);
+  return true;
+}
+
+bool AllocationTracker::updatePipe(ID resource_id, PipeInfoConstPtr pipe)
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = pipes_.find(resource_id);
+  if (it == pipes_.end())
+  {
+    return false;
+  }
+  it->second.pipe = std::move(pipe);
+  return true;
+}
+
+void AllocationTracker::eraseFromBucket(IdBucketMap& buckets, uint64_t key, ID resource_id)
+{
+  auto bucket_it = buckets.find(key);
+  if (bucket_it == buckets.end())
+  {
+    return;
+  }
+
+  // A pipe may list the same segment more than once
+  IdBucket& bucket = bucket_it->second;
+  bucket.erase(std::remove(bucket.begin(), bucket.end(), resource_id), bucket.end());
+
+  if (bucket.empty())
+  {
+    buckets.erase(bucket_it);
+  }
+}
+
+bool AllocationTracker::hasSameIndexKeys(const Component& c1, const Component& c2)
+{
+  return c1.local == c2.local &&
+         c1.component->getPackageNameSymbol() == c2.component->getPackageNameSymbol() &&
+         c1.component->getExecutableSymbol() == c2.component->getExecutableSymbol() &&
+         c1.component->getTypeSymbol() == c2.component->getTypeSymbol();
+}
+
+void AllocationTracker::indexComponent(ID resource_id, const Component& component)
+{
+  if (component.local)
+  {
+    by_package_executable_[ComponentInfoIndex::packageExecutableKey(
+      component.component->getPackageNameSymbol(), component.component->getExecutableSymbol())].push_back(resource_id);
+  }
+  by_type_[component.component->getTypeSymbol()].push_back(resource_id);
+}
+
+void AllocationTracker::unindexComponent(ID resource_id, const Component& component)
+{
+  if (component.local)
+  {
+    eraseFromBucket(by_package_executable_
+    , ComponentInfoIndex::packageExecutableKey(component.component->getPackageNameSymbol()
+                                              , component.component->getExecutableSymbol())
+    , resource_id);
+  }
+  eraseFromBucket(by_type_, component.component->getTypeSymbol(), resource_id);
+}
+
+void AllocationTracker::unindexPipe(ID resource_id, const Pipe& pipe)
+{
+  for (int sub_resource_id : pipe.sub_resource_ids)
+  {
+    eraseFromBucket(by_segment_, sub_resource_id, resource_id);
+  }
+}
+
+} // component_manager namespace
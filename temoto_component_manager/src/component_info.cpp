@@ -19,16 +19,37 @@
 #include "temoto_core/common/tools.h"
 #include "temoto_component_manager/component_info.h"
 #include "ros/ros.h"
+#include <algorithm>
 
 namespace temoto_component_manager
 {
 using namespace temoto_core;
 
+namespace
+{
+
+// Mixes a value into the hash (splitmix64 finalizer), so that similar identities spread out
+uint64_t hashCombine(uint64_t hash, uint64_t value)
+{
+  uint64_t x = hash ^ (value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2));
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+void insertSorted(std::vector<Symbol>& symbols, Symbol symbol)
+{
+  symbols.insert(std::upper_bound(symbols.begin(), symbols.end(), symbol), symbol);
+}
+
+} // anonymous namespace
+
 ComponentInfo::ComponentInfo(std::string component_name)
 {
   //set the component to current namespace
-  temoto_namespace_ = common::getTemotoNamespace();
-  component_name_ = component_name;
+  temoto_namespace_ = SymbolTable::identifiers().internString(common::getTemotoNamespace());
+  component_name_ = SymbolTable::identifiers().internString(component_name);
+  updateIdentityHash();
 }
 
 /* * * * * * * * * * * *
@@ -36,15 +57,15 @@ ComponentInfo::ComponentInfo(std::string component_name)
    * * * * * * * * * * * */
 
 // Get the temoto namespace where this component is defined
-std::string ComponentInfo::getTemotoNamespace() const
+const std::string& ComponentInfo::getTemotoNamespace() const
 {
-  return temoto_namespace_;
+  return temoto_namespace_.str();
 }
 
 /// Get name
-std::string ComponentInfo::getName() const
+const std::string& ComponentInfo::getName() const
 {
-  return component_name_;
+  return component_name_.str();
 }
 
 // Get input topics
@@ -80,8 +101,23 @@ std::vector<diagnostic_msgs::KeyValue> ComponentInfo::getRequiredParametersAsKey
   return input_topics_.inputTopicsAsKeyValues();
 }
 
+const SymbolMask& ComponentInfo::getInputTopicTypes() const
+{
+  return input_topic_types_;
+}
+
+const SymbolMask& ComponentInfo::getOutputTopicTypes() const
+{
+  return output_topic_types_;
+}
+
+const SymbolMask& ComponentInfo::getRequiredParameterTypes() const
+{
+  return required_parameter_types_;
+}
+
 // Get topic by type
-std::string ComponentInfo::getTopicByType(const std::string& type, const std::vector<StringPair>& topics)
+std::string ComponentInfo::getTopicByType(const std::string& type, const std::vector<StringPair>& topics) const
 {
   // Loop over the topics and check the type match. Return the topic if the types amatch
   for(auto&topic : topics)
@@ -96,47 +132,72 @@ std::string ComponentInfo::getTopicByType(const std::string& type, const std::ve
 }
 
 // Get input topic
-std::string ComponentInfo::getInputTopic(const std::string& type)
+std::string ComponentInfo::getInputTopic(const std::string& type) const
 {
   return getTopicByType(type, input_topics_.getInputTopics());
 }
 
 // Get output topic
-std::string ComponentInfo::getOutputTopic(const std::string& type)
+std::string ComponentInfo::getOutputTopic(const std::string& type) const
 {
   return getTopicByType(type, output_topics_.getOutputTopics());
 }
 
 // Get output topic
-std::string ComponentInfo::getRequiredParameter(const std::string& type)
+std::string ComponentInfo::getRequiredParameter(const std::string& type) const
 {
   return getTopicByType(type, required_parameters_.getInputTopics());
 }
 
 // Get component type
-std::string ComponentInfo::getType() const
+const std::string& ComponentInfo::getType() const
 {
-  return component_type_;
+  return component_type_.str();
 }
 
 // Get component package name
-std::string ComponentInfo::getPackageName() const
+const std::string& ComponentInfo::getPackageName() const
 {
-  return package_name_;
+  return package_name_.str();
 }
 
 // Get executable
-std::string ComponentInfo::getExecutable() const
+const std::string& ComponentInfo::getExecutable() const
 {
-  return executable_;
+  return executable_.str();
 }
 
 // Get description
-std::string ComponentInfo::getDescription() const
+const std::string& ComponentInfo::getDescription() const
 {
   return description_;
 }
 
+Symbol ComponentInfo::getTemotoNamespaceSymbol() const
+{
+  return temoto_namespace_.symbol();
+}
+
+Symbol ComponentInfo::getNameSymbol() const
+{
+  return component_name_.symbol();
+}
+
+Symbol ComponentInfo::getTypeSymbol() const
+{
+  return component_type_.symbol();
+}
+
+Symbol ComponentInfo::getPackageNameSymbol() const
+{
+  return package_name_.symbol();
+}
+
+Symbol ComponentInfo::getExecutableSymbol() const
+{
+  return executable_.symbol();
+}
+
 // Get reliability
 float ComponentInfo::getReliability() const
 {
@@ -155,6 +216,27 @@ bool ComponentInfo::getAdvertised() const
   return advertised_;
 }
 
+uint64_t ComponentInfo::getIdentityHash() const
+{
+  return identity_hash_;
+}
+
+bool ComponentInfo::hasSameIdentity(const ComponentInfo& other) const
+{
+  // Differing hashes rule out the rest of the comparison
+  return identity_hash_ == other.identity_hash_ &&
+         temoto_namespace_.symbol() == other.temoto_namespace_.symbol() &&
+         package_name_.symbol() == other.package_name_.symbol() &&
+         executable_.symbol() == other.executable_.symbol() &&
+         input_topic_type_list_ == other.input_topic_type_list_ &&
+         output_topic_type_list_ == other.output_topic_type_list_;
+}
+
+const std::shared_ptr<const LaunchPlan>& ComponentInfo::getLaunchPlan() const
+{
+  return launch_plan_;
+}
+
 // To string
 std::string ComponentInfo::toString() const
 {
@@ -196,42 +278,58 @@ std::string ComponentInfo::toString() const
 
 void ComponentInfo::setTemotoNamespace(std::string temoto_namespace)
 {
-  temoto_namespace_ = temoto_namespace;
+  temoto_namespace_ = SymbolTable::identifiers().internString(temoto_namespace);
+  updateIdentityHash();
 }
 
 void ComponentInfo::setName(std::string name)
 {
-  component_name_ = name;
+  component_name_ = SymbolTable::identifiers().internString(name);
 }
 
 void ComponentInfo::addTopicIn(StringPair topic)
 {
   input_topics_.addInputTopic(topic.first, topic.second);
+  Symbol topic_type = SymbolTable::keys().intern(topic.first);
+  input_topic_types_.insert(topic_type);
+  insertSorted(input_topic_type_list_, topic_type);
+  updateIdentityHash();
+  launch_plan_.reset();
 }
 
 void ComponentInfo::addTopicOut(StringPair topic)
 {
   output_topics_.addOutputTopic(topic.first, topic.second);
+  Symbol topic_type = SymbolTable::keys().intern(topic.first);
+  output_topic_types_.insert(topic_type);
+  insertSorted(output_topic_type_list_, topic_type);
+  updateIdentityHash();
+  launch_plan_.reset();
 }
 
 void ComponentInfo::addRequiredParameter(temoto_core::StringPair required_parameter)
 {
   required_parameters_.addInputTopic(required_parameter.first, required_parameter.second);
+  required_parameter_types_.insert(SymbolTable::keys().intern(required_parameter.first));
+  launch_plan_.reset();
 }
 
 void ComponentInfo::setType(std::string component_type)
 {
-  component_type_ = component_type;
+  component_type_ = SymbolTable::identifiers().internString(component_type);
 }
 
 void ComponentInfo::setPackageName(std::string package_name)
 {
-  package_name_ = package_name;
+  package_name_ = SymbolTable::identifiers().internString(package_name);
+  updateIdentityHash();
 }
 
 void ComponentInfo::setExecutable(std::string executable)
 {
-  executable_ = executable;
+  executable_ = SymbolTable::identifiers().internString(executable);
+  updateIdentityHash();
+  launch_plan_.reset();
 }
 
 void ComponentInfo::setDescription(std::string description)
@@ -254,4 +352,29 @@ void ComponentInfo::resetReliability(float reliability)
   reliability_.resetReliability(reliability);
 }
 
+void ComponentInfo::setLaunchPlan(std::shared_ptr<const LaunchPlan> launch_plan)
+{
+  launch_plan_ = std::move(launch_plan);
+}
+
+void ComponentInfo::updateIdentityHash()
+{
+  uint64_t hash = hashCombine(0, temoto_namespace_.symbol());
+  hash = hashCombine(hash, package_name_.symbol());
+  hash = hashCombine(hash, executable_.symbol());
+
+  // The sizes separate the input topic types from the output topic types
+  hash = hashCombine(hash, input_topic_type_list_.size());
+  for (Symbol topic_type : input_topic_type_list_)
+  {
+    hash = hashCombine(hash, topic_type);
+  }
+  hash = hashCombine(hash, output_topic_type_list_.size());
+  for (Symbol topic_type : output_topic_type_list_)
+  {
+    hash = hashCombine(hash, topic_type);
+  }
+  identity_hash_ = hash;
+}
+
 }  // ComponentManager namespace
@@ -0,0 +1,196 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Author: Robert Valner */
+
+#include "temoto_component_manager/component_info_index.h"
+#include <algorithm>
+
+namespace temoto_component_manager
+{
+
+const ComponentInfoConstPtrs& ComponentInfoIndex::getComponents() const
+{
+  return components_;
+}
+
+ComponentInfoConstPtr ComponentInfoIndex::find(const ComponentInfo& ci) const
+{
+  int position = findPosition(ci);
+  if (position < 0)
+  {
+    return NULL;
+  }
+  return components_[position];
+}
+
+bool ComponentInfoIndex::add(ComponentInfoConstPtr ci)
+{
+  if (findPosition(*ci) >= 0)
+  {
+    return false;
+  }
+
+  components_.push_back(std::move(ci));
+  insertIntoBuckets(components_.size() - 1);
+  return true;
+}
+
+bool ComponentInfoIndex::update(const ComponentInfo& ci, bool advertised)
+{
+  int position = findPosition(ci);
+  if (position < 0)
+  {
+    return false;
+  }
+
+  // The identity (namespace, package, executable) stays the same but the name and the type
+  // might have changed, hence reindex the component
+  std::shared_ptr<ComponentInfo> updated_ci = std::make_shared<ComponentInfo>(ci);
+  updated_ci->setAdvertised(advertised);
+
+  eraseFromBuckets(position);
+  components_[position] = std::move(updated_ci);
+  insertIntoBuckets(position);
+  return true;
+}
+
+bool ComponentInfoIndex::remove(const ComponentInfo& ci)
+{
+  int position = findPosition(ci);
+  if (position < 0)
+  {
+    return false;
+  }
+
+  // Move the last component into the freed position so that the other positions stay valid
+  std::size_t last = components_.size() - 1;
+  eraseFromBuckets(position);
+  if (std::size_t(position) != last)
+  {
+    eraseFromBuckets(last);
+    components_[position] = std::move(components_[last]);
+    insertIntoBuckets(position);
+  }
+  components_.pop_back();
+  return true;
+}
+
+const ComponentInfoIndex::Bucket* ComponentInfoIndex::findByType(Symbol component_type) const
+{
+  return findBucket(by_type_, component_type);
+}
+
+const ComponentInfoIndex::Bucket* ComponentInfoIndex::findByName(Symbol component_name) const
+{
+  return findBucket(by_name_, component_name);
+}
+
+const ComponentInfoIndex::Bucket* ComponentInfoIndex::findByPackageExecutable(Symbol package_name
+                                                                             , Symbol executable) const
+{
+  return findBucket(by_package_executable_, packageExecutableKey(package_name, executable));
+}
+
+const ComponentInfoIndex::Bucket* ComponentInfoIndex::findByNamespace(Symbol temoto_namespace) const
+{
+  return findBucket(by_namespace_, temoto_namespace);
+}
+
+uint64_t ComponentInfoIndex::packageExecutableKey(Symbol package_name, Symbol executable)
+{
+  return (uint64_t(package_name) << 32) | executable;
+}
+
+const ComponentInfoIndex::Bucket* ComponentInfoIndex::findBucket(const BucketMap& buckets, uint64_t key)
+{
+  const auto it = buckets.find(key);
+  if (it == buckets.end())
+  {
+    return NULL;
+  }
+  return &it->second;
+}
+
+void ComponentInfoIndex::eraseFromBucket(BucketMap& buckets, uint64_t key, std::size_t position)
+{
+  auto bucket_it = buckets.find(key);
+  if (bucket_it == buckets.end())
+  {
+    return;
+  }
+
+  Bucket& bucket = bucket_it->second;
+  bucket.erase(std::remove(bucket.begin(), bucket.end(), position), bucket.end());
+
+  if (bucket.empty())
+  {
+    buckets.erase(bucket_it);
+  }
+}
+
+int ComponentInfoIndex::findPosition(const ComponentInfo& ci) const
+{
+  // Equal components always share the package and the executable
+  const Bucket* bucket = findByPackageExecutable(ci.getPackageNameSymbol(), ci.getExecutableSymbol());
+  if (bucket == NULL)
+  {
+    return -1;
+  }
+
+  for (std::size_t position : *bucket)
+  {
+    if (*components_[position] == ci)
+    {
+      return position;
+    }
+  }
+  return -1;
+}
+
+void ComponentInfoIndex::insertIntoBucket(Bucket& bucket, std::size_t position) const
+{
+  // Insert after all components that are at least as reliable
+  float reliability = components_[position]->getReliability();
+  auto insert_it = std::upper_bound( bucket.begin()
+                                   , bucket.end()
+                                   , reliability
+                                   , [this](float r, std::size_t p)
+                                     {
+                                       return r > components_[p]->getReliability();
+                                     });
+  bucket.insert(insert_it, position);
+}
+
+void ComponentInfoIndex::insertIntoBuckets(std::size_t position)
+{
+  const ComponentInfo& ci = *components_[position];
+  insertIntoBucket(by_type_[ci.getTypeSymbol()], position);
+  insertIntoBucket(by_name_[ci.getNameSymbol()], position);
+  insertIntoBucket(by_package_executable_[packageExecutableKey(ci.getPackageNameSymbol(), ci.getExecutableSymbol())], position);
+  insertIntoBucket(by_namespace_[ci.getTemotoNamespaceSymbol()], position);
+}
+
+void ComponentInfoIndex::eraseFromBuckets(std::size_t position)
+{
+  const ComponentInfo& ci = *components_[position];
+  eraseFromBucket(by_type_, ci.getTypeSymbol(), position);
+  eraseFromBucket(by_name_, ci.getNameSymbol(), position);
+  eraseFromBucket(by_package_executable_, packageExecutableKey(ci.getPackageNameSymbol(), ci.getExecutableSymbol()), position);
+  eraseFromBucket(by_namespace_, ci.getTemotoNamespaceSymbol(), position);
+}
+
+} // component_manager namespace
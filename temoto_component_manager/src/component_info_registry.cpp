@@ -17,7 +17,10 @@
 /* Author: Robert Valner */
 
 #include "temoto_component_manager/component_info_registry.h"
+#include "temoto_component_manager/registry_snapshot.h"
+#include "temoto_component_manager/launch_plan.h"
 #include <algorithm>
+#include <set>
 
 namespace temoto_component_manager
 {
@@ -26,213 +29,1142 @@ using namespace temoto_core;
 ComponentInfoRegistry::ComponentInfoRegistry(temoto_core::BaseSubsystem* b)
 : temoto_core::BaseSubsystem(*b, __func__)
 {
-  // Start the component update cleanup loop thread
-  update_callback_cleanup_thread_ = std::thread(&ComponentInfoRegistry::updateCallbackCleanupLoop, this);
+  // Publish an empty initial snapshot
+  std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>();
+  snapshot->local_components = std::make_shared<ComponentInfoIndex>();
+  snapshot->remote_components = std::make_shared<RemotePartitions>();
+  snapshot->pipes = std::make_shared<PipeCatalog>();
+  std::atomic_store(&snapshot_, SnapshotPtr(snapshot));
+
+  // Start the threads that deliver the update events to the callbacks
+  stop_update_threads_ = false;
+  update_dispatcher_thread_ = std::thread(&ComponentInfoRegistry::updateDispatcherLoop, this);
+  for (unsigned int i=0; i<UPDATE_WORKER_COUNT; i++)
+  {
+    update_worker_threads_.emplace_back(&ComponentInfoRegistry::updateWorkerLoop, this);
+  }
 }
 
-void ComponentInfoRegistry::registerUpdateCallback( std::function<void(ComponentInfo)> cir_update_callback)
+void ComponentInfoRegistry::registerUpdateCallback( std::function<void(ComponentInfoConstPtr)> cir_update_callback)
 {
   // TODO: Check if the callback is unique
+  std::lock_guard<std::mutex> guard(cir_update_callbacks_mutex_);
   cir_update_callbacks_.push_back(cir_update_callback);
 }
 
-bool ComponentInfoRegistry::callUpdateCallbacks(ComponentInfo ci)
+bool ComponentInfoRegistry::callUpdateCallbacks(ComponentInfoConstPtr ci)
 {
-  bool all_cbs_invoked_successfully = true;
-  for (const auto& cir_update_callback : cir_update_callbacks_)
   {
-    if(!cir_update_callback)
+    std::lock_guard<std::mutex> guard(cir_update_callbacks_mutex_);
+    if (cir_update_callbacks_.empty())
     {
-      all_cbs_invoked_successfully = false;
-      continue;
+      return false;
     }
-    try
+  }
+
+  /*
+   * The push itself does not block. The mutex only orders setting the flag with the dispatcher
+   * clearing it, and the flag is set after the push is complete, so the dispatcher drains again
+   * after any push that its previous drain did not see
+   */
+  update_events_.push(std::move(ci));
+
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(update_events_mutex_);
+  update_events_pending_ = true;
+  update_events_cv_.notify_one();
+  return true;
+}
+
+void ComponentInfoRegistry::updateDispatcherLoop()
+{
+  while(true)
+  {
     {
-      std::lock_guard<std::recursive_mutex> guard(cir_cb_update_mutex_);
-      TEMOTO_DEBUG_STREAM("Invoking an update callback in a separate thread ...");
-      cir_update_callback_threads_.emplace_back(cir_update_callback, ci);
+      // Sleep until an event is pushed. The events pushed after the flag is cleared set it
+      // again, hence none of them is left in the queue unnoticed
+      std::unique_lock<std::mutex> lock(update_events_mutex_);
+      update_events_cv_.wait(lock, [&]
+      {
+        return stop_update_threads_ || update_events_pending_;
+      });
+
+      if (stop_update_threads_)
+      {
+        break;
+      }
+      update_events_pending_ = false;
     }
-    catch(const std::exception& e)
+
+    ComponentInfoConstPtr ci;
+    bool got_events = false;
+    std::lock_guard<std::mutex> guard(pending_updates_mutex_);
+    while (update_events_.pop(ci))
     {
-      all_cbs_invoked_successfully = false;
-      continue;
+      got_events = true;
+
+      /*
+       * The callback reacts only to components that are more reliable than the allocated
+       * component of the same type, hence delivering just the most reliable component of each
+       * type is equivalent to delivering all of them
+       */
+      Symbol type = ci->getTypeSymbol();
+      auto pending_it = pending_updates_.find(type);
+      if (pending_it == pending_updates_.end())
+      {
+        pending_updates_.emplace(type, std::move(ci));
+        pending_update_order_.push_back(type);
+      }
+      else if (ci->getReliability() > pending_it->second->getReliability())
+      {
+        pending_it->second = std::move(ci);
+      }
     }
-    catch(...)
+
+    if (got_events)
     {
-      all_cbs_invoked_successfully = false;
-      continue;
+      pending_updates_cv_.notify_all();
     }
   }
-  return all_cbs_invoked_successfully;
 }
 
-void ComponentInfoRegistry::updateCallbackCleanupLoop()
+void ComponentInfoRegistry::updateWorkerLoop()
 {
   while(true)
   {
-    // Sleep for 1 second
-    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    ComponentInfoConstPtr ci;
+    {
+      std::unique_lock<std::mutex> lock(pending_updates_mutex_);
+      pending_updates_cv_.wait(lock, [&]
+      {
+        return stop_update_threads_ || !pending_update_order_.empty();
+      });
 
-    std::lock_guard<std::recursive_mutex> guard(cir_cb_update_mutex_);
-    if (stop_cleanup_loop_ /*&& cir_update_callback_threads_.empty()*/)
+      if (stop_update_threads_)
+      {
+        break;
+      }
+
+      auto pending_it = pending_updates_.find(pending_update_order_.front());
+      pending_update_order_.pop_front();
+      ci = std::move(pending_it->second);
+      pending_updates_.erase(pending_it);
+    }
+
+    std::vector<std::function<void(ComponentInfoConstPtr)>> cir_update_callbacks;
     {
-      break;
+      std::lock_guard<std::mutex> guard(cir_update_callbacks_mutex_);
+      cir_update_callbacks = cir_update_callbacks_;
     }
 
-    for (auto it=cir_update_callback_threads_.begin();
-         it!=cir_update_callback_threads_.end();
-         /* empty */)
+    for (const auto& cir_update_callback : cir_update_callbacks)
     {
-      if (it->joinable())
+      if(!cir_update_callback)
+      {
+        continue;
+      }
+      try
+      {
+        TEMOTO_DEBUG_STREAM("Invoking an update callback ...");
+        cir_update_callback(ci);
+      }
+      catch(const std::exception& e)
       {
-        TEMOTO_DEBUG_STREAM("An update callback has finished, joining the thread.");
-        it->join();
-        cir_update_callback_threads_.erase(it);
+        TEMOTO_ERROR_STREAM("An update callback failed: " << e.what());
       }
-      else
+      catch(...)
       {
-        it++;
+        TEMOTO_ERROR_STREAM("An update callback failed with an unknown exception");
       }
     }
   }
 }
 
+ComponentInfoRegistry::SnapshotPtr ComponentInfoRegistry::getSnapshot() const
+{
+  return std::atomic_load(&snapshot_);
+}
+
+uint64_t ComponentInfoRegistry::publishSnapshot( std::shared_ptr<const ComponentInfoIndex> local_components
+                                               , std::shared_ptr<const RemotePartitions> remote_components
+                                               , std::shared_ptr<const PipeCatalog> pipes
+                                               , const Changes& changes )
+{
+  SnapshotPtr current = getSnapshot();
+  std::shared_ptr<Snapshot> next = std::make_shared<Snapshot>(*current);
+
+  next->version = current->version + 1;
+  if (local_components)
+  {
+    next->local_components = local_components;
+  }
+  if (remote_components)
+  {
+    next->remote_components = remote_components;
+  }
+  if (pipes)
+  {
+    next->pipes = pipes;
+  }
+
+  /*
+   * Lock the mutex. The snapshot is swapped in together with its change log entries, hence
+   * #getChangesSince never returns a part of a generation and a reader that has seen a
+   * snapshot finds all the changes up to its version in the log
+   */
+  std::lock_guard<std::mutex> guard(change_log_mutex_);
+
+  std::atomic_store(&snapshot_, SnapshotPtr(next));
+  for (const auto& change : changes)
+  {
+    if (change_log_.size() >= CHANGE_LOG_CAPACITY)
+    {
+      change_log_truncated_generation_ = change_log_.front().generation;
+      change_log_.pop_front();
+    }
+    change_log_.push_back(ComponentChange{next->version, change.first, local_components != nullptr, change.second});
+  }
+
+  // Wake up the persisting thread, the remote components are not persisted
+  if (local_components || pipes)
+  {
+    std::lock_guard<std::mutex> persist_guard(persist_mutex_);
+    persist_pending_ = true;
+    persist_cv_.notify_one();
+  }
+  return next->version;
+}
+
+bool ComponentInfoRegistry::getChangesSince(uint64_t generation, std::vector<ComponentChange>& changes) const
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(change_log_mutex_);
+
+  if (generation < change_log_truncated_generation_)
+  {
+    return false;
+  }
+
+  // The log is ordered by generation, hence binary search for the first newer change
+  auto first_newer = std::upper_bound( change_log_.begin()
+                                     , change_log_.end()
+                                     , generation
+                                     , [](uint64_t g, const ComponentChange& change)
+                                       {
+                                         return g < change.generation;
+                                       });
+
+  changes.insert(changes.end(), first_newer, change_log_.end());
+  return true;
+}
+
 bool ComponentInfoRegistry::addLocalComponent(const ComponentInfo& ci)
+{
+  return addLocalComponents(std::vector<ComponentInfo>{ci}) == 1;
+}
+
+unsigned int ComponentInfoRegistry::addLocalComponents(const std::vector<ComponentInfo>& cis)
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(write_mutex_);
+
+  // Skip the components that already exist. Checked before copying the index
+  // because the snooping agents keep re-adding the components they find
+  SnapshotPtr snapshot = getSnapshot();
+  std::vector<const ComponentInfo*> new_components;
+  for (const auto& ci : cis)
+  {
+    if (snapshot->local_components->find(ci) == NULL)
+    {
+      new_components.push_back(&ci);
+    }
+  }
+
+  if (new_components.empty())
+  {
+    return 0;
+  }
+
+  // Add the components to a single new version of the index
+  std::shared_ptr<ComponentInfoIndex> local_components
+    = std::make_shared<ComponentInfoIndex>(*snapshot->local_components);
+
+  // The same immutable copy is shared by the index, the change log and the callbacks
+  ComponentInfoConstPtrs added_components;
+  for (const ComponentInfo* ci : new_components)
+  {
+    // The batch itself might contain duplicates
+    if (local_components->find(*ci) != NULL)
+    {
+      continue;
+    }
+    ComponentInfoConstPtr added_component = std::make_shared<const ComponentInfo>(withLaunchPlan(*ci));
+    local_components->add(added_component);
+    added_components.push_back(added_component);
+  }
+
+  Changes changes;
+  for (const auto& added_component : added_components)
+  {
+    changes.emplace_back(ComponentChange::ADDED, added_component);
+  }
+  publishSnapshot(local_components, nullptr, nullptr, changes);
+  for (const auto& added_component : added_components)
+  {
+    invalidateQueryCache(true, added_component->getTypeSymbol());
+  }
+  refreshPipeFeasibility();
+
+  // Trigger the cir update callbacks
+  for (const auto& added_component : added_components)
+  {
+    callUpdateCallbacks(added_component);
+  }
+
+  return added_components.size();
+}
+
+bool ComponentInfoRegistry::addRemoteComponent(const ComponentInfo &ci)
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(write_mutex_);
+
+  // Return false if such component already exists
+  SnapshotPtr snapshot = getSnapshot();
+  const ComponentInfoIndex* partition = findRemotePartition(*snapshot, ci.getTemotoNamespace());
+  if (partition != NULL && partition->find(ci) != NULL)
+  {
+    return false;
+  }
+
+  // Add the component to a new version of the partition
+  std::shared_ptr<ComponentInfoIndex> new_partition = (partition != NULL)
+    ? std::make_shared<ComponentInfoIndex>(*partition)
+    : std::make_shared<ComponentInfoIndex>();
+
+  ComponentInfoConstPtr added_component = std::make_shared<const ComponentInfo>(ci);
+  new_partition->add(added_component);
+  publishSnapshot( nullptr
+                 , replaceRemotePartition(*snapshot, ci.getTemotoNamespace(), new_partition)
+                 , nullptr
+                 , Changes{{ComponentChange::ADDED, added_component}});
+  invalidateQueryCache(false, ci.getTypeSymbol());
+  refreshPipeFeasibility();
+  return true;
+}
+
+bool ComponentInfoRegistry::updateLocalComponent(const ComponentInfo &ci, bool advertised)
+{
+  return updateLocalComponents(std::vector<ComponentInfo>{ci}, advertised) == 1;
+}
+
+unsigned int ComponentInfoRegistry::updateLocalComponents(const std::vector<ComponentInfo>& cis, bool advertised)
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(write_mutex_);
+
+  /*
+   * Update the local components that are found. The index is copied only once there is something
+   * to update, since most calls come with a single component that may well be unknown
+   */
+  SnapshotPtr snapshot = getSnapshot();
+  std::shared_ptr<ComponentInfoIndex> local_components;
+
+  std::vector<const ComponentInfo*> updated_components;
+  std::vector<Symbol> previous_types;
+  for (const auto& ci : cis)
+  {
+    ComponentInfoConstPtr previous_component = (local_components != NULL)
+      ? local_components->find(ci)
+      : snapshot->local_components->find(ci);
+    if (previous_component == NULL)
+    {
+      continue;
+    }
+    if (local_components == NULL)
+    {
+      local_components = std::make_shared<ComponentInfoIndex>(*snapshot->local_components);
+    }
+    previous_types.push_back(previous_component->getTypeSymbol());
+    local_components->update(withLaunchPlan(ci), advertised);
+    updated_components.push_back(&ci);
+  }
+
+  if (updated_components.empty())
+  {
+    return 0;
+  }
+
+  Changes changes;
+  for (const ComponentInfo* updated_component : updated_components)
+  {
+    changes.emplace_back(ComponentChange::UPDATED, local_components->find(*updated_component));
+  }
+  publishSnapshot(local_components, nullptr, nullptr, changes);
+
+  for (std::size_t i=0; i<changes.size(); i++)
+  {
+    const ComponentInfoConstPtr& ci = changes[i].second;
+
+    /*
+     * The type might have changed as well. The topic types are a part of the identity, hence
+     * if the type stayed the same, the component still serves the same pipe segments and only
+     * its rank in the query results (e.g. its reliability) might have changed
+     */
+    bool type_changed = (previous_types[i] != ci->getTypeSymbol());
+    invalidateQueryCache(true, ci->getTypeSymbol(), type_changed);
+    if (type_changed)
+    {
+      invalidateQueryCache(true, previous_types[i]);
+    }
+  }
+  refreshPipeFeasibility();
+  return updated_components.size();
+}
+
+bool ComponentInfoRegistry::updateRemoteComponent(const ComponentInfo &ci, bool advertised)
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(write_mutex_);
+
+  // Update the remote component if its found, return false otherwise
+  SnapshotPtr snapshot = getSnapshot();
+  const ComponentInfoIndex* partition = findRemotePartition(*snapshot, ci.getTemotoNamespace());
+  ComponentInfoConstPtr previous_component = (partition != NULL) ? partition->find(ci) : NULL;
+  if (previous_component == NULL)
+  {
+    return false;
+  }
+
+  std::shared_ptr<ComponentInfoIndex> new_partition = std::make_shared<ComponentInfoIndex>(*partition);
+  new_partition->update(ci, advertised);
+  publishSnapshot( nullptr
+                 , replaceRemotePartition(*snapshot, ci.getTemotoNamespace(), new_partition)
+                 , nullptr
+                 , Changes{{ComponentChange::UPDATED, new_partition->find(ci)}});
+
+  // The type might have changed as well, otherwise the pipe feasibility stays the same
+  bool type_changed = (previous_component->getTypeSymbol() != ci.getTypeSymbol());
+  invalidateQueryCache(false, ci.getTypeSymbol(), type_changed);
+  if (type_changed)
+  {
+    invalidateQueryCache(false, previous_component->getTypeSymbol());
+  }
+  refreshPipeFeasibility();
+  return true;
+}
+
+bool ComponentInfoRegistry::removeLocalComponent(const ComponentInfo &ci)
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(write_mutex_);
+
+  SnapshotPtr snapshot = getSnapshot();
+  ComponentInfoConstPtr removed_component = snapshot->local_components->find(ci);
+  if (removed_component == NULL)
+  {
+    return false;
+  }
+
+  std::shared_ptr<ComponentInfoIndex> local_components
+    = std::make_shared<ComponentInfoIndex>(*snapshot->local_components);
+
+  local_components->remove(ci);
+  publishSnapshot(local_components, nullptr, nullptr, Changes{{ComponentChange::REMOVED, removed_component}});
+  invalidateQueryCache(true, removed_component->getTypeSymbol());
+  refreshPipeFeasibility();
+  return true;
+}
+
+bool ComponentInfoRegistry::removeRemoteComponent(const ComponentInfo &ci)
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(write_mutex_);
+
+  SnapshotPtr snapshot = getSnapshot();
+  const ComponentInfoIndex* partition = findRemotePartition(*snapshot, ci.getTemotoNamespace());
+  ComponentInfoConstPtr removed_component = (partition != NULL) ? partition->find(ci) : NULL;
+  if (removed_component == NULL)
+  {
+    return false;
+  }
+
+  std::shared_ptr<ComponentInfoIndex> new_partition = std::make_shared<ComponentInfoIndex>(*partition);
+  new_partition->remove(ci);
+  publishSnapshot( nullptr
+                 , replaceRemotePartition(*snapshot, ci.getTemotoNamespace(), new_partition)
+                 , nullptr
+                 , Changes{{ComponentChange::REMOVED, removed_component}});
+  invalidateQueryCache(false, removed_component->getTypeSymbol());
+  refreshPipeFeasibility();
+  return true;
+}
+
+void ComponentInfoRegistry::mergeRemoteComponents( const std::string& temoto_namespace
+                                                 , const std::vector<ComponentInfo>& components )
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(write_mutex_);
+
+  SnapshotPtr snapshot = getSnapshot();
+  const ComponentInfoIndex* partition = findRemotePartition(*snapshot, temoto_namespace);
+  std::shared_ptr<ComponentInfoIndex> new_partition = (partition != NULL)
+    ? std::make_shared<ComponentInfoIndex>(*partition)
+    : std::make_shared<ComponentInfoIndex>();
+
+  // Add or update each component with a single lookup
+  Changes changes;
+  std::set<Symbol> changed_types;
+  for (const auto& advertised_component : components)
+  {
+    ComponentInfoPtr component = std::make_shared<ComponentInfo>(advertised_component);
+    component->setTemotoNamespace(temoto_namespace);
+
+    ComponentInfoConstPtr previous_component = new_partition->find(*component);
+    if (previous_component != NULL)
+    {
+      changed_types.insert(previous_component->getTypeSymbol());
+      new_partition->update(*component, false);
+      changes.emplace_back(ComponentChange::UPDATED, new_partition->find(*component));
+    }
+    else
+    {
+      new_partition->add(component);
+      changes.emplace_back(ComponentChange::ADDED, component);
+    }
+    changed_types.insert(component->getTypeSymbol());
+  }
+
+  if (changes.empty())
+  {
+    return;
+  }
+
+  publishSnapshot(nullptr, replaceRemotePartition(*snapshot, temoto_namespace, new_partition), nullptr, changes);
+  for (Symbol changed_type : changed_types)
+  {
+    invalidateQueryCache(false, changed_type);
+  }
+  refreshPipeFeasibility();
+}
+
+void ComponentInfoRegistry::replaceRemoteComponents( const std::string& temoto_namespace
+                                                   , const std::vector<ComponentInfo>& components )
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(write_mutex_);
+
+  SnapshotPtr snapshot = getSnapshot();
+  const ComponentInfoIndex* partition = findRemotePartition(*snapshot, temoto_namespace);
+
+  // Build the new partition from scratch
+  std::shared_ptr<ComponentInfoIndex> new_partition = std::make_shared<ComponentInfoIndex>();
+  Changes changes;
+  std::set<Symbol> changed_types;
+  for (const auto& advertised_component : components)
+  {
+    ComponentInfoPtr component = std::make_shared<ComponentInfo>(advertised_component);
+    component->setTemotoNamespace(temoto_namespace);
+
+    if (!new_partition->add(component))
+    {
+      continue;
+    }
+
+    bool existed = (partition != NULL) && (partition->find(*component) != NULL);
+    changes.emplace_back(existed ? ComponentChange::UPDATED : ComponentChange::ADDED, component);
+    changed_types.insert(component->getTypeSymbol());
+  }
+
+  // Components that were not advertised anymore are removed
+  if (partition != NULL)
+  {
+    for (const auto& previous_component : partition->getComponents())
+    {
+      changed_types.insert(previous_component->getTypeSymbol());
+      if (new_partition->find(*previous_component) == NULL)
+      {
+        changes.emplace_back(ComponentChange::REMOVED, previous_component);
+      }
+    }
+  }
+
+  if (changes.empty())
+  {
+    return;
+  }
+
+  publishSnapshot(nullptr, replaceRemotePartition(*snapshot, temoto_namespace, new_partition), nullptr, changes);
+  for (Symbol changed_type : changed_types)
+  {
+    invalidateQueryCache(false, changed_type);
+  }
+  refreshPipeFeasibility();
+}
+
+bool ComponentInfoRegistry::removeRemoteNamespace(const std::string& temoto_namespace)
 {
   // Lock the mutex
-  std::lock_guard<std::recursive_mutex> guard(read_write_mutex);
+  std::lock_guard<std::mutex> guard(write_mutex_);
+
+  SnapshotPtr snapshot = getSnapshot();
+  const ComponentInfoIndex* partition = findRemotePartition(*snapshot, temoto_namespace);
+  if (partition == NULL)
+  {
+    return false;
+  }
+
+  // The partition is dropped as a whole, the components are visited only to log the removals
+  Changes changes;
+  std::set<Symbol> removed_types;
+  for (const auto& removed_component : partition->getComponents())
+  {
+    changes.emplace_back(ComponentChange::REMOVED, removed_component);
+    removed_types.insert(removed_component->getTypeSymbol());
+  }
+  publishSnapshot(nullptr, replaceRemotePartition(*snapshot, temoto_namespace, nullptr), nullptr, changes);
+  for (Symbol removed_type : removed_types)
+  {
+    invalidateQueryCache(false, removed_type);
+  }
+  refreshPipeFeasibility();
+  return true;
+}
+
+const ComponentInfoIndex* ComponentInfoRegistry::findRemotePartition( const Snapshot& snapshot
+                                                                    , const std::string& temoto_namespace )
+{
+  const auto partition_it = snapshot.remote_components->find(temoto_namespace);
+  if (partition_it == snapshot.remote_components->end())
+  {
+    return NULL;
+  }
+  return partition_it->second.get();
+}
+
+std::shared_ptr<const ComponentInfoRegistry::RemotePartitions> ComponentInfoRegistry::replaceRemotePartition(
+  const Snapshot& snapshot
+, const std::string& temoto_namespace
+, std::shared_ptr<const ComponentInfoIndex> partition )
+{
+  std::shared_ptr<RemotePartitions> partitions = std::make_shared<RemotePartitions>(*snapshot.remote_components);
+  if (partition && !partition->getComponents().empty())
+  {
+    (*partitions)[temoto_namespace] = partition;
+  }
+  else
+  {
+    partitions->erase(temoto_namespace);
+  }
+  return partitions;
+}
+
+bool ComponentInfoRegistry::findLocalComponents( LoadComponent::Request& req
+                                         , ComponentInfoConstPtrs& ci_ret ) const
+{
+  return findComponentsCached(req, true, ci_ret);
+}
+
+bool ComponentInfoRegistry::findLocalComponent( const ComponentInfo &ci, ComponentInfoConstPtr& ci_ret ) const
+{
+  return findComponent(ci, *getSnapshot()->local_components, ci_ret);
+}
+
+bool ComponentInfoRegistry::findLocalComponent( const ComponentInfo &ci ) const
+{
+  return getSnapshot()->local_components->find(ci) != NULL;
+}
+
+bool ComponentInfoRegistry::findRemoteComponents( LoadComponent::Request& req
+                                          , ComponentInfoConstPtrs& ci_ret ) const
+{
+  return findComponentsCached(req, false, ci_ret);
+}
+
+bool ComponentInfoRegistry::findRemoteComponent( const ComponentInfo &ci, ComponentInfoConstPtr& ci_ret ) const
+{
+  SnapshotPtr snapshot = getSnapshot();
+  const ComponentInfoIndex* partition = findRemotePartition(*snapshot, ci.getTemotoNamespace());
+  return partition != NULL && findComponent(ci, *partition, ci_ret);
+}
+
+bool ComponentInfoRegistry::findRemoteComponent( const ComponentInfo &ci ) const
+{
+  SnapshotPtr snapshot = getSnapshot();
+  const ComponentInfoIndex* partition = findRemotePartition(*snapshot, ci.getTemotoNamespace());
+  return partition != NULL && partition->find(ci) != NULL;
+}
+
+bool ComponentInfoRegistry::findComponentsCached( LoadComponent::Request& req
+                                               , bool local
+                                               , ComponentInfoConstPtrs& ci_ret ) const
+{
+  // If the type is not interned, then no component can match it
+  Symbol component_type;
+  if (!SymbolTable::identifiers().find(req.component_type, component_type))
+  {
+    return false;
+  }
+
+  const std::string key = queryCacheKey(req, local);
+  const uint64_t type_key = (uint64_t(!local) << 32) | component_type;
+  uint64_t type_generation = 0;
+  std::shared_ptr<const ComponentInfoConstPtrs> candidates;
+  {
+    // Lock the mutex
+    std::lock_guard<std::mutex> guard(query_cache_mutex_);
+
+    const auto generation_it = type_generations_.find(type_key);
+    if (generation_it != type_generations_.end())
+    {
+      type_generation = generation_it->second;
+    }
+
+    const auto entry_it = query_cache_.find(key);
+    if (entry_it != query_cache_.end() && entry_it->second.type_generation == type_generation)
+    {
+      query_cache_stats_.hits++;
+      candidates = entry_it->second.candidates;
+    }
+    else
+    {
+      query_cache_stats_.misses++;
+    }
+  }
+
+  /*
+   * Resolve the query on a miss. The type generation is read before the snapshot, hence
+   * a change that is published in between only causes a spurious miss later on
+   */
+  if (!candidates)
+  {
+    SnapshotPtr snapshot = getSnapshot();
+    std::shared_ptr<ComponentInfoConstPtrs> found_candidates = std::make_shared<ComponentInfoConstPtrs>();
+    if (local)
+    {
+      findComponents(req, *snapshot->local_components, *found_candidates);
+    }
+    else
+    {
+      // Merge the ranked candidates of each remote manager into one ranking
+      for (const auto& partition : *snapshot->remote_components)
+      {
+        ComponentInfoConstPtrs partition_candidates;
+        if (!findComponents(req, *partition.second, partition_candidates))
+        {
+          continue;
+        }
+
+        std::size_t middle = found_candidates->size();
+        found_candidates->insert( found_candidates->end()
+                                , std::make_move_iterator(partition_candidates.begin())
+                                , std::make_move_iterator(partition_candidates.end()));
+        std::inplace_merge( found_candidates->begin()
+                          , found_candidates->begin() + middle
+                          , found_candidates->end()
+                          , [](const ComponentInfoConstPtr& ci1, const ComponentInfoConstPtr& ci2)
+                            {
+                              return ci1->getReliability() > ci2->getReliability();
+                            });
+      }
+    }
+    candidates = found_candidates;
+
+    // Lock the mutex
+    std::lock_guard<std::mutex> guard(query_cache_mutex_);
+    if (query_cache_.size() >= QUERY_CACHE_CAPACITY)
+    {
+      query_cache_.clear();
+    }
+    query_cache_[key] = QueryCacheEntry{type_generation, candidates};
+  }
+
+  if (candidates->empty())
+  {
+    // Component with the requested criteria was not found.
+    return false;
+  }
+
+  ci_ret = *candidates;
+  return true;
+}
+
+std::string ComponentInfoRegistry::queryCacheKey(const LoadComponent::Request& req, bool local)
+{
+  // Fields are separated by a character that does not appear in names nor types
+  const char separator = '\x1f';
+  std::string key;
+  key += local ? 'L' : 'R';
+  key += separator + req.component_type;
+  key += separator + req.component_name;
+  key += separator + req.package_name;
+  key += separator + req.executable;
+
+  for (const std::vector<diagnostic_msgs::KeyValue>* keys : {&req.input_topics, &req.output_topics, &req.required_parameters})
+  {
+    std::vector<std::string> sorted_keys;
+    sorted_keys.reserve(keys->size());
+    for (const auto& key_value : *keys)
+    {
+      sorted_keys.push_back(key_value.key);
+    }
+    std::sort(sorted_keys.begin(), sorted_keys.end());
+
+    key += separator;
+    for (const auto& sorted_key : sorted_keys)
+    {
+      key += sorted_key + ',';
+    }
+  }
+  return key;
+}
+
+void ComponentInfoRegistry::invalidateQueryCache(bool local, Symbol component_type, bool affects_feasibility)
+{
+  {
+    // Lock the mutex
+    std::lock_guard<std::mutex> guard(query_cache_mutex_);
+    type_generations_[(uint64_t(!local) << 32) | component_type]++;
+  }
+
+  if (affects_feasibility)
+  {
+    stale_segment_types_.insert(component_type);
+  }
+}
+
+ComponentInfo ComponentInfoRegistry::withLaunchPlan(const ComponentInfo& ci)
+{
+  ComponentInfo planned_ci = ci;
+  if (!planned_ci.getLaunchPlan())
+  {
+    planned_ci.setLaunchPlan(std::make_shared<const LaunchPlan>(ci));
+  }
+  return planned_ci;
+}
+
+LoadComponent::Request ComponentInfoRegistry::segmentRequest(const PipeInfo& pipe, unsigned int segment_index)
+{
+  const std::vector<Segment>& segments = pipe.getSegments();
+  const Segment& segment = segments[segment_index];
+
+  LoadComponent::Request segment_req;
+  segment_req.component_type = segment.segment_type_;
+  for (Symbol topic_type : segment.required_input_topic_types_)
+  {
+    diagnostic_msgs::KeyValue input_topic;
+    input_topic.key = SymbolTable::keys().str(topic_type);
+    segment_req.input_topics.push_back(input_topic);
+  }
+
+  // The last segment provides its own output topics, others provide the inputs of the next segment
+  const SymbolSet& output_topic_types = (segment_index != segments.size()-1)
+    ? segments[segment_index+1].required_input_topic_types_
+    : segment.required_output_topic_types_;
+
+  for (Symbol topic_type : output_topic_types)
+  {
+    diagnostic_msgs::KeyValue output_topic;
+    output_topic.key = SymbolTable::keys().str(topic_type);
+    segment_req.output_topics.push_back(output_topic);
+  }
+  return segment_req;
+}
+
+bool ComponentInfoRegistry::isPipeFeasible(const PipeInfo& pipe) const
+{
+  for (unsigned int i=0; i<pipe.getSegments().size(); i++)
+  {
+    // The component manager falls back to remote components even if only local ones were asked for
+    LoadComponent::Request segment_req = segmentRequest(pipe, i);
+    ComponentInfoConstPtrs candidates;
+    if (!findComponentsCached(segment_req, true, candidates) &&
+        !findComponentsCached(segment_req, false, candidates))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ComponentInfoRegistry::refreshPipeFeasibility()
+{
+  if (stale_segment_types_.empty())
+  {
+    return;
+  }
+
+  SnapshotPtr snapshot = getSnapshot();
+  std::shared_ptr<PipeCatalog> pipes;
+  for (Symbol segment_type : stale_segment_types_)
+  {
+    const PipeCatalog::Bucket* affected_pipes = snapshot->pipes->findBySegmentType(segment_type);
+    if (affected_pipes == NULL)
+    {
+      continue;
+    }
+
+    for (std::size_t position : *affected_pipes)
+    {
+      const PipeCatalog& current_pipes = pipes ? *pipes : *snapshot->pipes;
+      bool feasible = isPipeFeasible(*current_pipes.getPipes()[position]);
+      if (feasible == current_pipes.isFeasible(position))
+      {
+        continue;
+      }
+
+      // Copy the catalog only when some flag actually changes
+      if (!pipes)
+      {
+        pipes = std::make_shared<PipeCatalog>(*snapshot->pipes);
+      }
+      pipes->setFeasible(position, feasible);
+    }
+  }
+  stale_segment_types_.clear();
+
+  if (pipes)
+  {
+    publishSnapshot(nullptr, nullptr, pipes);
+  }
+}
+
+ComponentInfoRegistry::QueryCacheStats ComponentInfoRegistry::getQueryCacheStats() const
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(query_cache_mutex_);
+  QueryCacheStats stats = query_cache_stats_;
+  stats.entries = query_cache_.size();
+  return stats;
+}
+
+bool ComponentInfoRegistry::restoreSnapshot(const std::string& path)
+{
+  std::vector<ComponentInfo> components;
+  PipeInfos pipes;
+  if (!RegistrySnapshotFile::read(path, components, pipes))
+  {
+    return false;
+  }
+
+  TEMOTO_INFO_STREAM("Restoring " << components.size() << " components and " << pipes.size()
+                     << " pipes from '" << path << "'");
+
+  addLocalComponents(components);
+  addPipes(pipes);
+
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(write_mutex_);
+  restored_components_ = components;
+  restored_pipes_ = pipes;
+  return true;
+}
+
+void ComponentInfoRegistry::startPersisting(const std::string& path)
+{
+  if (persist_thread_.joinable())
+  {
+    return;
+  }
+  persist_thread_ = std::thread(&ComponentInfoRegistry::persistLoop, this, path);
+}
+
+void ComponentInfoRegistry::persistLoop(std::string path)
+{
+  std::shared_ptr<const ComponentInfoIndex> persisted_local_components;
+  std::shared_ptr<const PipeCatalog> persisted_pipes;
+
+  std::unique_lock<std::mutex> lock(persist_mutex_);
+  while(true)
+  {
+    // Sleep until a change is published. When stopping, the last changes are written first
+    persist_cv_.wait(lock, [&]
+    {
+      return stop_persisting_ || persist_pending_;
+    });
+
+    if (!persist_pending_)
+    {
+      break;
+    }
+    persist_pending_ = false;
+
+    // The published parts are immutable, so a changed pointer means changed contents
+    SnapshotPtr snapshot = getSnapshot();
+    if (snapshot->local_components == persisted_local_components &&
+        snapshot->pipes == persisted_pipes)
+    {
+      continue;
+    }
 
-  // Check if there is no such component
-  ComponentInfo ci_ret;
-  if (!findComponent(ci, local_components_, ci_ret))
-  {
-    local_components_.push_back(ci);
+    lock.unlock();
+    bool written = RegistrySnapshotFile::write(path, snapshot->local_components->getComponents(), snapshot->pipes->getPipes());
+    lock.lock();
 
-    // Trigger the cir update callback
-    callUpdateCallbacks(ci);
+    if (!written)
+    {
+      TEMOTO_WARN_STREAM("Could not write the registry snapshot to '" << path << "'");
+    }
 
-    return true;
+    // Not retried on failure until the next change
+    persisted_local_components = snapshot->local_components;
+    persisted_pipes = snapshot->pipes;
   }
-
-  // Return false if such component already exists
-  return false;
 }
 
-bool ComponentInfoRegistry::addRemoteComponent(const ComponentInfo &ci)
+void ComponentInfoRegistry::reconcileRestoredComponents( const std::vector<ComponentInfo>& scanned_components
+                                                       , bool scan_complete )
 {
   // Lock the mutex
-  std::lock_guard<std::recursive_mutex> guard(read_write_mutex);
+  std::lock_guard<std::mutex> guard(write_mutex_);
 
-  // Check if there is no such component
-  ComponentInfo ci_ret;
-  if (!findComponent(ci, remote_components_, ci_ret))
+  if (restored_components_.empty())
   {
-    remote_components_.push_back(ci);
-    return true;
+    return;
   }
 
-  // Return false if such component already exists
-  return false;
-}
-
-bool ComponentInfoRegistry::updateLocalComponent(const ComponentInfo &ci, bool advertised)
-{
-  // Lock the mutex
-  std::lock_guard<std::recursive_mutex> guard(read_write_mutex);
-
-  const auto it = std::find_if( local_components_.begin()
-                              , local_components_.end()
-                              , [&](const ComponentInfo& ls)
-                              {
-                                return ls == ci;
-                              });
-
-  // Update the local component if its found
-  if (it != local_components_.end())
+  ComponentInfoIndex scanned_index;
+  for (const auto& scanned_component : scanned_components)
   {
-    *it = ci;
-    it->setAdvertised( advertised );
-    return true;
+    scanned_index.add(std::make_shared<const ComponentInfo>(scanned_component));
   }
 
-  // Return false if no such component was found
-  return false;
-}
+  SnapshotPtr snapshot = getSnapshot();
+  std::shared_ptr<ComponentInfoIndex> local_components
+    = std::make_shared<ComponentInfoIndex>(*snapshot->local_components);
 
-bool ComponentInfoRegistry::updateRemoteComponent(const ComponentInfo &ci, bool advertised)
-{
-  // Lock the mutex
-  std::lock_guard<std::recursive_mutex> guard(read_write_mutex);
+  Changes changes;
+  std::set<Symbol> changed_types;
+  std::vector<ComponentInfo> unconfirmed_components;
+  for (const auto& restored_component : restored_components_)
+  {
+    ComponentInfoConstPtr current_component = local_components->find(restored_component);
+    if (current_component == NULL)
+    {
+      continue;
+    }
 
-  const auto it = std::find_if( remote_components_.begin()
-                              , remote_components_.end()
-                              , [&](const ComponentInfo& rs)
-                              {
-                                return rs == ci;
-                              });
+    ComponentInfoConstPtr scanned_component = scanned_index.find(restored_component);
+    if (scanned_component != NULL)
+    {
+      /*
+       * The scan does not re-add an existing component, hence replace the restored descriptor
+       * with the scanned one, in case it has changed. The reliability learned by the previous
+       * run is kept and the component gets advertised again
+       */
+      ComponentInfo refreshed_component = withLaunchPlan(*scanned_component);
+      refreshed_component.resetReliability(current_component->getReliability());
+      local_components->update(refreshed_component, false);
+      changes.emplace_back(ComponentChange::UPDATED, local_components->find(refreshed_component));
+      changed_types.insert(current_component->getTypeSymbol());
+      changed_types.insert(refreshed_component.getTypeSymbol());
+    }
+    else if (scan_complete)
+    {
+      local_components->remove(restored_component);
+      changes.emplace_back(ComponentChange::REMOVED, current_component);
+      changed_types.insert(current_component->getTypeSymbol());
+    }
+    else
+    {
+      // The descriptor of the component might have failed to parse, try again after the next scan
+      unconfirmed_components.push_back(restored_component);
+    }
+  }
+  restored_components_ = unconfirmed_components;
 
-  // Update the local component if its found
-  if (it != remote_components_.end())
+  if (changes.empty())
   {
-    *it = ci;
-    it->setAdvertised( advertised );
-    return true;
+    return;
   }
 
-  // Return false if no such component was found
-  return false;
+  TEMOTO_INFO_STREAM("Reconciled " << changes.size() << " restored components with the workspace, "
+                     << restored_components_.size() << " left unconfirmed");
+  publishSnapshot(local_components, nullptr, nullptr, changes);
+  for (Symbol changed_type : changed_types)
+  {
+    invalidateQueryCache(true, changed_type);
+  }
+  refreshPipeFeasibility();
 }
 
-bool ComponentInfoRegistry::findLocalComponents( LoadComponent::Request& req
-                                         , std::vector<ComponentInfo>& ci_ret ) const
+void ComponentInfoRegistry::reconcileRestoredPipes(const PipeInfos& scanned_pipes, bool scan_complete)
 {
   // Lock the mutex
-  std::lock_guard<std::recursive_mutex> guard(read_write_mutex);
-
-  return findComponents(req, local_components_, ci_ret);
-}
+  std::lock_guard<std::mutex> guard(write_mutex_);
 
-bool ComponentInfoRegistry::findLocalComponent( const ComponentInfo &ci, ComponentInfo& ci_ret ) const
-{
-  // Lock the mutex
-  std::lock_guard<std::recursive_mutex> guard(read_write_mutex);
+  if (restored_pipes_.empty())
+  {
+    return;
+  }
 
-  return findComponent(ci, local_components_, ci_ret);
-}
+  PipeCatalog scanned_catalog;
+  for (const auto& scanned_pipe : scanned_pipes)
+  {
+    scanned_catalog.add(std::make_shared<const PipeInfo>(scanned_pipe));
+  }
 
-bool ComponentInfoRegistry::findLocalComponent( const ComponentInfo &ci ) const
-{
-  // Lock the mutex
-  std::lock_guard<std::recursive_mutex> guard(read_write_mutex);
+  // The pipes are identified by their contents, hence a scanned pipe is never stale. Remove the
+  // restored pipes that a complete scan did not find anymore
+  std::shared_ptr<PipeCatalog> pipes = std::make_shared<PipeCatalog>(*getSnapshot()->pipes);
 
-  ComponentInfo ci_ret;
-  return findComponent(ci, local_components_, ci_ret);
-}
+  bool pipes_removed = false;
+  PipeInfos unconfirmed_pipes;
+  for (const auto& restored_pipe : restored_pipes_)
+  {
+    if (scanned_catalog.find(restored_pipe) != NULL)
+    {
+      continue;
+    }
 
-bool ComponentInfoRegistry::findRemoteComponents( LoadComponent::Request& req
-                                          , std::vector<ComponentInfo>& ci_ret ) const
-{
-  // Lock the mutex
-  std::lock_guard<std::recursive_mutex> guard(read_write_mutex);
+    if (!scan_complete)
+    {
+      unconfirmed_pipes.push_back(restored_pipe);
+    }
+    else if (pipes->remove(restored_pipe))
+    {
+      pipes_removed = true;
+    }
+  }
+  restored_pipes_ = unconfirmed_pipes;
 
-  return findComponents(req, remote_components_, ci_ret);
+  if (pipes_removed)
+  {
+    publishSnapshot(nullptr, nullptr, pipes);
+  }
 }
 
-bool ComponentInfoRegistry::findRemoteComponent( const ComponentInfo &ci, ComponentInfo& ci_ret ) const
+ComponentInfoRegistry::KeyRequirement::KeyRequirement(const std::vector<diagnostic_msgs::KeyValue>& keys)
+: keys_(keys)
 {
-  // Lock the mutex
-  std::lock_guard<std::recursive_mutex> guard(read_write_mutex);
+  for (const auto& key : keys_)
+  {
+    Symbol symbol;
+    if (!SymbolTable::keys().find(key.key, symbol))
+    {
+      // None of the known components has this key
+      satisfiable_ = false;
+      return;
+    }
 
-  return findComponent(ci, remote_components_, ci_ret);
+    if (mask_.contains(symbol))
+    {
+      has_duplicates_ = true;
+    }
+    mask_.insert(symbol);
+  }
 }
 
-bool ComponentInfoRegistry::findRemoteComponent( const ComponentInfo &ci ) const
+bool ComponentInfoRegistry::satisfies( const KeyRequirement& requirement
+                                     , const SymbolMask& types
+                                     , const std::vector<temoto_core::StringPair>& topics ) const
 {
-  // Lock the mutex
-  std::lock_guard<std::recursive_mutex> guard(read_write_mutex);
-
-  ComponentInfo ci_ret;
-  return findComponent(ci, remote_components_, ci_ret);
+  if (requirement.has_duplicates_)
+  {
+    // Multiple topics of the same type are requested, count them one by one
+    return !compareTopics(topics, requirement.keys_);
+  }
+  return requirement.mask_.isSubsetOf(types);
 }
 
 bool ComponentInfoRegistry::compareTopics( const std::vector<temoto_core::StringPair>& l_topics
@@ -272,336 +1204,342 @@ bool ComponentInfoRegistry::compareTopics( const std::vector<temoto_core::String
 }
 
 bool ComponentInfoRegistry::findComponents( LoadComponent::Request& req
-                                    , const std::vector<ComponentInfo>& components
-                                    , std::vector<ComponentInfo>& ci_ret ) const
+                                    , const ComponentInfoIndex& components
+                                    , ComponentInfoConstPtrs& ci_ret ) const
 {
-  // Local list of devices that follow the requirements
-  std::vector<ComponentInfo> candidates;
+  /*
+   * Resolve the requested identity fields into symbols. If any of the requested
+   * values is not interned, then no component can match it
+   */
+  const SymbolTable& identifiers = SymbolTable::identifiers();
+  Symbol component_type = 0;
+  Symbol component_name = 0;
+  Symbol package_name = 0;
+  Symbol executable = 0;
+
+  if (!identifiers.find(req.component_type, component_type) ||
+      (!req.component_name.empty() && !identifiers.find(req.component_name, component_name)) ||
+      (!req.package_name.empty() && !identifiers.find(req.package_name, package_name)) ||
+      (!req.executable.empty() && !identifiers.find(req.executable, executable)))
+  {
+    return false;
+  }
+
+  /*
+   * Pick the smallest bucket that has to contain all suitable candidates. The type
+   * is always required, the name and the package+executable pair narrow it down further
+   */
+  const ComponentInfoIndex::Bucket* bucket = components.findByType(component_type);
+  if (bucket == NULL)
+  {
+    // The requested type of component is not available
+    return false;
+  }
 
-  // Check if the name of the component is required
   if (!req.component_name.empty())
   {
-    std::copy_if( components.begin()
-                , components.end()
-                , std::back_inserter(candidates)
-                , [&](const ComponentInfo& s)
-                  {
-                    return s.getName() == req.component_name;
-                  });
+    const ComponentInfoIndex::Bucket* name_bucket = components.findByName(component_name);
+    if (name_bucket == NULL)
+    {
+      return false;
+    }
+    if (name_bucket->size() < bucket->size())
+    {
+      bucket = name_bucket;
+    }
+  }
 
-    if (candidates.empty())
+  if (!req.package_name.empty() && !req.executable.empty())
+  {
+    const ComponentInfoIndex::Bucket* pe_bucket = components.findByPackageExecutable(package_name, executable);
+    if (pe_bucket == NULL)
     {
       return false;
     }
+    if (pe_bucket->size() < bucket->size())
+    {
+      bucket = pe_bucket;
+    }
   }
 
-  // Find the devices that follow the "type" criteria
-  std::copy_if( components.begin()
-              , components.end()
-              , std::back_inserter(candidates)
-              , [&](const ComponentInfo& s)
-                {
-                  return s.getType() == req.component_type;
-                });
+  // Intern the requested topic types and parameters once for all candidates
+  KeyRequirement input_topics(req.input_topics);
+  KeyRequirement output_topics(req.output_topics);
+  KeyRequirement required_parameters(req.required_parameters);
 
-  // The requested type of component is not available
-  if (candidates.empty())
+  if (!input_topics.satisfiable_ || !output_topics.satisfiable_ || !required_parameters.satisfiable_)
   {
     return false;
   }
 
-  // If package_name is specified, remove all non-matching candidates
-  auto it_end = candidates.end();
-  if (req.package_name != "")
-  {
-    it_end = std::remove_if(candidates.begin(), candidates.end(),
-                            [&](ComponentInfo s)
-                            {
-                              return s.getPackageName() != req.package_name;
-                            });
-  }
+  // Local list of devices that follow the requirements, the most reliable first
+  ComponentInfoConstPtrs candidates;
+  candidates.reserve(bucket->size());
 
-  // If executable is specified, remove all non-matching candidates
-  if (req.executable != "")
+  for (std::size_t position : *bucket)
   {
-    it_end = std::remove_if(candidates.begin(), it_end,
-                            [&](ComponentInfo s)
-                            {
-                              return s.getExecutable() != req.executable;
-                            });
-  }
+    const ComponentInfoConstPtr& candidate = components.getComponents()[position];
+    const ComponentInfo& s = *candidate;
 
-  // If input topics are specified ...
-  if (!req.input_topics.empty())
-  {
-    it_end = std::remove_if(candidates.begin(), it_end,
-                            [&](ComponentInfo s)
-                            {
-                              return compareTopics(s.getInputTopics(), req.input_topics);
-                            });
-  }
+    if (s.getTypeSymbol() != component_type)
+    {
+      continue;
+    }
 
-  // If output topics are specified ...
-  if (!req.output_topics.empty())
-  {
-    it_end = std::remove_if(candidates.begin(), it_end,
-                            [&](ComponentInfo s)
-                            {
-                              return compareTopics(s.getOutputTopics(), req.output_topics);
-                            });
-  }
+    // If component name is specified, skip all non-matching candidates
+    if (!req.component_name.empty() && s.getNameSymbol() != component_name)
+    {
+      continue;
+    }
 
-  // If required parameters are specified ...
-  if (!req.required_parameters.empty())
-  {
-    it_end = std::remove_if(candidates.begin(), it_end,
-                            [&](ComponentInfo s)
-                            {
-                              return compareTopics(s.getRequiredParameters(), req.required_parameters);
-                            });
-  }
+    // If package_name is specified, skip all non-matching candidates
+    if (!req.package_name.empty() && s.getPackageNameSymbol() != package_name)
+    {
+      continue;
+    }
+
+    // If executable is specified, skip all non-matching candidates
+    if (!req.executable.empty() && s.getExecutableSymbol() != executable)
+    {
+      continue;
+    }
+
+    // If input topics are specified ...
+    if (!req.input_topics.empty() && !satisfies(input_topics, s.getInputTopicTypes(), s.getInputTopics()))
+    {
+      continue;
+    }
+
+    // If output topics are specified ...
+    if (!req.output_topics.empty() && !satisfies(output_topics, s.getOutputTopicTypes(), s.getOutputTopics()))
+    {
+      continue;
+    }
+
+    // If required parameters are specified ...
+    if (!req.required_parameters.empty() &&
+        !satisfies(required_parameters, s.getRequiredParameterTypes(), s.getRequiredParameters()))
+    {
+      continue;
+    }
 
-  // Sort remaining candidates based on their reliability.
-  std::sort( candidates.begin()
-           , it_end
-           , [](ComponentInfo& ci1, ComponentInfo& s2)
-             {
-               return ci1.getReliability() > s2.getReliability();
-             });
+    candidates.push_back(candidate);
+  }
 
-  if (candidates.begin() == it_end)
+  if (candidates.empty())
   {
     // Component with the requested criteria was not found.
     return false;
   }
 
-  // Return the first component of the requested type.
-  ci_ret = candidates;
+  // The buckets are kept in decreasing order of reliability, hence so are the candidates
+  ci_ret = std::move(candidates);
   return true;
 }
 
 bool ComponentInfoRegistry::findComponent( const ComponentInfo &ci
-                                   , const std::vector<ComponentInfo>& components
-                                   , ComponentInfo& ci_ret ) const
+                                   , const ComponentInfoIndex& components
+                                   , ComponentInfoConstPtr& ci_ret ) const
 {
-  const auto it = std::find_if( components.begin()
-                              , components.end()
-                              , [&](const ComponentInfo& rs)
-                              {
-                                return rs == ci;
-                              });
-
-
-  if (it == components.end())
+  ComponentInfoConstPtr found_ci = components.find(ci);
+  if (found_ci == NULL)
   {
     return false;
   }
   else
   {
-    ci_ret = *it;
+    ci_ret = std::move(found_ci);
     return true;
   }
 }
 
-const std::vector<ComponentInfo>& ComponentInfoRegistry::getLocalComponents() const
+/*
+ * ComponentInfoRegistry::findPipes
+ */
+bool ComponentInfoRegistry::providesOutputTopics( const PipeCatalog& pipes
+                                                , std::size_t position
+                                                , const SymbolMask& required_types )
 {
-  return local_components_;
+  // The output topic types of a segment are unique, hence each is matched by a different required topic
+  return pipes.getOutputTopicTypes(position).isSubsetOf(required_types);
 }
 
-const std::vector<ComponentInfo>& ComponentInfoRegistry::getRemoteComponents() const
+bool ComponentInfoRegistry::satisfiesSegmentSpecifiers( const PipeInfo& pipe
+                                                      , const LoadPipe::Request& req ) const
 {
-  return remote_components_;
-}
+  const std::vector<Segment>& segments = pipe.getSegments();
+  std::vector<bool> specified(segments.size(), false);
+  for (const auto& specifier : req.pipe_segment_specifiers)
+  {
+    // A specifier of a segment that does not exist cannot be satisfied
+    if (specifier.segment_index >= segments.size())
+    {
+      return false;
+    }
 
-const std::map<std::string, PipeInfos>& ComponentInfoRegistry::getPipes() const
-{
-  return categorized_pipes_;
+    // Like loadPipeCb, use only the first specifier of a segment
+    unsigned int i = specifier.segment_index;
+    if (specified[i])
+    {
+      continue;
+    }
+    specified[i] = true;
+
+    LoadComponent::Request segment_req = segmentRequest(pipe, i);
+    segment_req.component_name = specifier.component_name;
+    segment_req.required_parameters = specifier.parameters;
+
+    // Local or remote, see #isPipeFeasible
+    ComponentInfoConstPtrs candidates;
+    if (!findComponentsCached(segment_req, true, candidates) &&
+        !findComponentsCached(segment_req, false, candidates))
+    {
+      return false;
+    }
+  }
+  return true;
 }
 
-/*
- * ComponentInfoRegistry::findPipes
- */
 bool ComponentInfoRegistry::findPipes( const LoadPipe::Request& req
-                                     , PipeInfos& pipes_ret) const
+                                     , PipeInfoConstPtrs& pipes_ret) const
 {
-  // Lock the mutex
-  std::lock_guard<std::recursive_mutex> guard(read_write_mutex_pipe_);
+  // Hold on to the snapshot while the pipes are examined
+  SnapshotPtr snapshot = getSnapshot();
+  const PipeCatalog& pipes = *snapshot->pipes;
 
   // Get the tracking methods of the requested category
-  const auto& pipes_cat = categorized_pipes_.find(req.pipe_category);
+  const PipeCatalog::Bucket* category = pipes.findByCategory(req.pipe_category);
 
   // Throw an error if the requested pipe category does not exist
-  if (pipes_cat == categorized_pipes_.end())
+  if (category == NULL)
   {
     return false;
   }
 
-  // Get the pipes
-  pipes_ret = pipes_cat->second;
+  // Intern the required output topic types. Types that are not interned are provided by no pipe
+  SymbolMask required_types;
+  std::vector<Symbol> required_type_list;
+  for (const auto& output_topic : req.output_topics)
+  {
+    Symbol topic_type;
+    if (SymbolTable::keys().find(output_topic.key, topic_type))
+    {
+      required_types.insert(topic_type);
+      required_type_list.push_back(topic_type);
+    }
+  }
 
-  /*
-   * Check if a specific pipe (pipe_name is specified) is requested
-   */
-  if (!req.pipe_name.empty())
+  // Pipes that provide none of the required types are left out up front through the output topic index
+  PipeCatalog::Bucket output_candidates;
+  if (!req.output_topics.empty() && req.pipe_name.empty())
   {
-    // PipeInfos pipes
-    PipeInfos pipes_ret_cpy = pipes_ret;
-    bool named_pipe_found = false;
-    for (const auto& pipe_ret : pipes_ret_cpy)
+    if (!pipes.findByOutputTopicTypes(req.pipe_category, required_type_list, output_candidates))
     {
-      if(pipe_ret.getName() == req.pipe_name)
-      {
-        pipes_ret.clear();
-        pipes_ret.push_back(pipe_ret);
-        named_pipe_found = true;
-        break;
-      }
+      return false;
     }
+    category = &output_candidates;
+  }
 
-    if (!named_pipe_found)
+  // A specific pipe (pipe_name is specified) is looked up by its name instead of scanning the category
+  PipeCatalog::Bucket named_pipe;
+  if (!req.pipe_name.empty())
+  {
+    int position = pipes.findByName(req.pipe_name);
+    if (position < 0 || pipes.getPipes()[position]->getType() != req.pipe_category)
     {
       return false;
     }
+    named_pipe.push_back(position);
+    category = &named_pipe;
   }
 
   /*
-   * TODO: Check the segment specifiers
+   * Collect the suitable pipes. The categories are kept in decreasing order of
+   * reliability, hence so are the returned pipes
    */
-  // if (!req.pipe_segment_specifiers.empty())
-  // {
-  //   // Loop over pipes
-  //   for (auto pipe_it = pipes_ret.begin(); pipe_it != pipes_ret.end(); /* empty */)
-  //   {
-  //     // Remove the pipe if its last filter does not contain the required topic type
-  //     if ( false)
-  //     {
-  //       pipes_ret.erase(pipe_it);
-  //     }
-  //     else
-  //     {
-  //       pipe_it++;
-  //     }
-  //   }
-  // }
-
-  /*
-   * Check if there are any required types for the output topics of the pipe
-   */ 
-  if (!req.output_topics.empty())
+  pipes_ret.clear();
+  for (std::size_t position : *category)
   {
-    // Loop over pipes
-    for (auto pipe_it = pipes_ret.begin(); pipe_it != pipes_ret.end(); /* empty */)
-    {
-      bool pipe_suitable = true;
-
-      // Create a copy of the required topics
-      std::vector<diagnostic_msgs::KeyValue> req_topic_types = req.output_topics;
-      std::set<std::string> last_filter_topics = pipe_it->getSegments().back().required_output_topic_types_;
-
-      // The topics that the last filter of the pipe provides
-      for (auto& last_filter_topic : last_filter_topics)
-      {
-        bool topic_found = false;
+    const PipeInfoConstPtr& pipe = pipes.getPipes()[position];
 
-        // Compare the topic of the last filter with the required topics
-        for (auto rtt_it = req_topic_types.begin(); rtt_it != req_topic_types.end(); rtt_it++)
-        {
-          if (rtt_it->key == last_filter_topic)
-          {
-            topic_found = true;
-            req_topic_types.erase(rtt_it);
-            break;
-          }
-        }
-
-        // If the required topic was not found then break the loop and indicate
-        // that the pipe is not suitable
-        if (!topic_found)
-        {
-          pipe_suitable = false;
-          break;
-        }
-      }
+    // Skip the pipes that have a segment which no known component can serve
+    if (!pipes.isFeasible(position))
+    {
+      continue;
+    }
 
-      // Remove the pipe if its last filter does not contain the required topic type
-      if (!pipe_suitable)
-      {
-        pipes_ret.erase(pipe_it);
-      }
-      else
-      {
-        pipe_it++;
-      }
+    // Check if there are any required types for the output topics of the pipe
+    if (!req.output_topics.empty() && !providesOutputTopics(pipes, position, required_types))
+    {
+      continue;
     }
 
-    // If no pipe was suitable, then throw an error
-    if (pipes_ret.empty())
+    // Check if the specified segments can be loaded at all
+    if (!req.pipe_segment_specifiers.empty() && !satisfiesSegmentSpecifiers(*pipe, req))
     {
-      return false;
+      continue;
     }
+
+    pipes_ret.push_back(pipe);
   }
 
-  /*
-   * Sort the pipes with decreasing reliability order
-   */
-  std::sort( pipes_ret.begin()
-           , pipes_ret.end()
-           , [](const PipeInfo& lhs, const PipeInfo& rhs)
-             {
-               return lhs.reliability_.getReliability() >
-                      rhs.reliability_.getReliability();
-             });
+  // If no pipe was suitable, then throw an error
+  if (pipes_ret.empty())
+  {
+    return false;
+  }
 
   return true;
 }
 
-PipeInfo* ComponentInfoRegistry::findPipe ( const PipeInfo& pi )
+bool ComponentInfoRegistry::addPipe( const PipeInfo& pi)
 {
-  // Check if the requested type exists
-  const auto pipes_it = categorized_pipes_.find(pi.getType());
-  PipeInfo* pi_ret = NULL;
+  return addPipes(PipeInfos{pi}) == 1;
+}
 
-  if (pipes_it == categorized_pipes_.end())
-  {
-    return pi_ret;
-  }
-  
-  // Check if there is such a pipe as requested
-  const auto pipe_it = std::find_if( pipes_it->second.begin()
-    , pipes_it->second.end()
-    , [&](const PipeInfo& rs)
-    {
-      return rs == pi;
-    });
+/*
+ * ComponentInfoRegistry::addPipes
+ */
+unsigned int ComponentInfoRegistry::addPipes( const PipeInfos& pis )
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(write_mutex_);
 
-  if (pipe_it == pipes_it->second.end())
+  // Skip the pipes that already exist
+  SnapshotPtr snapshot = getSnapshot();
+  std::vector<const PipeInfo*> new_pipes;
+  for (const auto& pi : pis)
   {
-    return pi_ret;
+    if (snapshot->pipes->find(pi) == NULL)
+    {
+      new_pipes.push_back(&pi);
+    }
   }
-  else
+
+  if (new_pipes.empty())
   {
-    pi_ret = &(*pipe_it);
-    return pi_ret;
+    return 0;
   }
-}
-
-bool ComponentInfoRegistry::addPipe( const PipeInfo& pi)
-{
-  // Lock the mutex
-  std::lock_guard<std::recursive_mutex> guard(read_write_mutex_pipe_);
 
-  // Check if there is no such pipe
-  PipeInfo* pi_ret = findPipe(pi);
-  if (pi_ret == NULL)
+  std::shared_ptr<PipeCatalog> pipes = std::make_shared<PipeCatalog>(*snapshot->pipes);
+  unsigned int added_count = 0;
+  for (const PipeInfo* pi : new_pipes)
   {
+    // The batch itself might contain duplicates
+    if (pipes->find(*pi) != NULL)
+    {
+      continue;
+    }
+
     // Create an unique identifier for this specific pipe_info instance
-    std::string pipe_name = pi.getType() + std::to_string(pipe_info_id_manager_.generateID());
-    categorized_pipes_[pi.getType()].emplace_back(pi, pipe_name);
-    return true;
+    std::string pipe_name = pi->getType() + std::to_string(pipe_info_id_manager_.generateID());
+    pipes->add(std::make_shared<const PipeInfo>(*pi, pipe_name));
+    pipes->setFeasible(pipes->getPipes().size() - 1, isPipeFeasible(*pi));
+    added_count++;
   }
 
-  // Return false if such pipe already exists
-  return false;
+  publishSnapshot(nullptr, nullptr, pipes);
+  return added_count;
 }
 
 /*
@@ -610,23 +1548,48 @@ bool ComponentInfoRegistry::addPipe( const PipeInfo& pi)
 bool ComponentInfoRegistry::updatePipe( const PipeInfo& pi )
 {
   // Lock the mutex
-  std::lock_guard<std::recursive_mutex> guard(read_write_mutex_pipe_);
+  std::lock_guard<std::mutex> guard(write_mutex_);
 
-  PipeInfo* pi_ret = findPipe(pi);
-  if (pi_ret != NULL)
+  // Return false if no such pipe was found
+  SnapshotPtr snapshot = getSnapshot();
+  if (snapshot->pipes->find(pi) == NULL)
   {
-    *pi_ret = pi;
-    return true;
+    return false;
   }
 
-  // Return false if no such pipe was found
-  return false;
+  // The reliability might have changed, the catalog moves the pipe to its new place in the order
+  std::shared_ptr<PipeCatalog> pipes = std::make_shared<PipeCatalog>(*snapshot->pipes);
+  pipes->update(std::make_shared<const PipeInfo>(pi));
+  publishSnapshot(nullptr, nullptr, pipes);
+  return true;
 }
 
 ComponentInfoRegistry::~ComponentInfoRegistry()
 {
-  stop_cleanup_loop_ = true;
-  update_callback_cleanup_thread_.join();
+  {
+    // Set the flag under the locks so that neither the dispatcher nor the workers miss the wakeup
+    std::lock_guard<std::mutex> events_guard(update_events_mutex_);
+    std::lock_guard<std::mutex> pending_guard(pending_updates_mutex_);
+    stop_update_threads_ = true;
+  }
+  update_events_cv_.notify_all();
+  pending_updates_cv_.notify_all();
+
+  {
+    std::lock_guard<std::mutex> persist_guard(persist_mutex_);
+    stop_persisting_ = true;
+  }
+  persist_cv_.notify_all();
+  if (persist_thread_.joinable())
+  {
+    persist_thread_.join();
+  }
+
+  update_dispatcher_thread_.join();
+  for (auto& update_worker_thread : update_worker_threads_)
+  {
+    update_worker_thread.join();
+  }
 }
 
 } // component_manager namespace
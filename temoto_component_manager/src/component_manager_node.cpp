@@ -17,12 +17,15 @@
 /* Author: Robert Valner */
 
 #include "temoto_core/common/base_subsystem.h"
+#include "temoto_core/common/tools.h"
 #include "temoto_component_manager/component_manager_services.h"
 #include "temoto_component_manager/component_manager_servers.h"
 #include "temoto_component_manager/component_info_registry.h"
 #include "temoto_component_manager/component_snooper.h"
 
 #include <signal.h>
+#include <cstdlib>
+#include <algorithm>
 
 using namespace temoto_component_manager;
 using namespace temoto_core;
@@ -48,6 +51,19 @@ public:
   {
     try
     {
+      /*
+       * Answer requests from the registry snapshot of the previous run while the workspace
+       * is being scanned. An empty path disables the snapshot
+       */
+      ros::NodeHandle nh_private("~");
+      std::string snapshot_path;
+      nh_private.param<std::string>("registry_snapshot_path", snapshot_path, getDefaultSnapshotPath());
+      if (!snapshot_path.empty())
+      {
+        cir_.restoreSnapshot(snapshot_path);
+        cir_.startPersisting(snapshot_path);
+      }
+
       cs_.startSnooping();
       TEMOTO_INFO("Component Manager is good to go.");
       return true;
@@ -68,6 +84,31 @@ public:
 
 private:
 
+  /**
+   * @brief Returns the snapshot file path in the ROS home directory. The temoto namespace is
+   * part of the file name so that managers on the same machine do not share the snapshot
+   */
+  static std::string getDefaultSnapshotPath()
+  {
+    std::string ros_home;
+    if (const char* ros_home_env = std::getenv("ROS_HOME"))
+    {
+      ros_home = ros_home_env;
+    }
+    else if (const char* home_env = std::getenv("HOME"))
+    {
+      ros_home = std::string(home_env) + "/.ros";
+    }
+    else
+    {
+      return "";
+    }
+
+    std::string file_name = "component_registry_" + temoto_core::common::getTemotoNamespace() + ".bin";
+    std::replace(file_name.begin(), file_name.end(), '/', '_');
+    return ros_home + "/" + file_name;
+  }
+
   /// Component Info Database
   ComponentInfoRegistry cir_;
 
@@ -92,8 +133,18 @@ int main(int argc, char** argv)
     return 1;
   }
 
-  //use single threaded spinner for global callback queue
-  ros::spin();
+  /*
+   * The global callback queue carries the resource requests and status messages, the relayed
+   * topics and the synchronization messages. It is served by several threads, so that a slow
+   * component launch does not hold up the other requests. The list services and the snooper
+   * have queues of their own
+   */
+  ros::NodeHandle nh_private("~");
+  int thread_count;
+  nh_private.param<int>("threads/resources", thread_count, 4);
+  ros::AsyncSpinner spinner(std::max(thread_count, 1));
+  spinner.start();
+  ros::waitForShutdown();
 
   return 0;
 }
@@ -22,18 +22,67 @@
 #include <utility>
 #include "yaml-cpp/yaml.h"
 #include <fstream>
-#include <regex>
+#include <future>
+#include <exception>
+#include <chrono>
+#include <thread>
+#include <atomic>
 
 namespace temoto_component_manager
 {
 using namespace temoto_core;
 
+namespace
+{
+/**
+ * @brief Reads the warm pool configuration from the private parameters of the node
+ */
+WarmPool::Config loadWarmPoolConfig()
+{
+  ros::NodeHandle nh_private("~");
+  WarmPool::Config config;
+  nh_private.param<int>("warm_pool/size", config.size, 0);
+  nh_private.param<int>("warm_pool/hot_requests", config.hot_requests, 3);
+  nh_private.param<double>("warm_pool/window", config.window, 600.0);
+  nh_private.param<double>("warm_pool/memory_budget_mb", config.memory_budget_mb, 0.0);
+  nh_private.param<double>("warm_pool/cpu_budget", config.cpu_budget, 0.0);
+  nh_private.param<std::map<std::string, double>>("warm_pool/memory_mb", config.memory_mb, {});
+  nh_private.param<std::map<std::string, double>>("warm_pool/cpu", config.cpu, {});
+  return config;
+}
+
+/**
+ * @brief Reads the number of threads that serve the list services
+ */
+int getListThreadCount()
+{
+  ros::NodeHandle nh_private("~");
+  int thread_count;
+  nh_private.param<int>("threads/list", thread_count, 1);
+  return std::max(thread_count, 1);
+}
+} // anonymous namespace
+
 ComponentManagerServers::ComponentManagerServers(BaseSubsystem *b, ComponentInfoRegistry *cir)
 : BaseSubsystem(*b, __func__)
 , cir_(cir)
 , resource_registrar_1_(srv_name::MANAGER, this)
 , resource_registrar_2_(srv_name::MANAGER_2, this)
+, warm_pool_(loadWarmPoolConfig())
+, list_spinner_(getListThreadCount(), &list_queue_)
 {
+  ros::NodeHandle nh_private("~");
+  nh_private.param<bool>("concurrent_pipe_bringup", concurrent_pipe_bringup_, false);
+  nh_private.param<int>("hedged_launch_candidates", hedged_launch_candidates_, 1);
+  nh_private.param<double>("hedged_launch_delay", hedged_launch_delay_, 2.0);
+  nh_private.param<int>("threads/batch", batch_thread_count_, 4);
+  batch_thread_count_ = std::max(batch_thread_count_, 1);
+
+  if (warm_pool_.enabled())
+  {
+    warm_pool_timer_ = nh_.createTimer(ros::Duration(1), &ComponentManagerServers::warmPoolTimerCb, this);
+  }
+
   /*
    * Set up the resource servers and register status callbacks
    */
@@ -45,20 +94,27 @@ ComponentManagerServers::ComponentManagerServers(BaseSubsystem *b, ComponentInfo
   , &ComponentManagerServers::loadPipeCb
   , &ComponentManagerServers::unloadPipeCb);
 
+  resource_registrar_2_.addServer<LoadComponents>( srv_name::BATCH_SERVER
+  , &ComponentManagerServers::loadComponentsCb
+  , &ComponentManagerServers::unloadComponentsCb);
+
   resource_registrar_1_.registerStatusCb(&ComponentManagerServers::statusCb1);
   resource_registrar_2_.registerStatusCb(&ComponentManagerServers::statusCb2);
 
   /*
    * Set up simple ROS servers that do not provide any resources
    */ 
-  list_components_server_ = nh_.advertiseService( srv_name::LIST_COMPONENTS_SERVER
+  list_nh_.setCallbackQueue(&list_queue_);
+  list_components_server_ = list_nh_.advertiseService( srv_name::LIST_COMPONENTS_SERVER
   , &ComponentManagerServers::listComponentsCb
   , this);
 
-  list_pipes_server_ = nh_.advertiseService( srv_name::LIST_PIPES_SERVER
+  list_pipes_server_ = list_nh_.advertiseService( srv_name::LIST_PIPES_SERVER
   , &ComponentManagerServers::listPipesCb
   , this);
 
+  list_spinner_.start();
+
   // Register the component update callback
   cir_->registerUpdateCallback(std::bind(&ComponentManagerServers::cirUpdateCallback, this, std::placeholders::_1));                                       
 
@@ -80,18 +136,19 @@ void ComponentManagerServers::statusCb1(temoto_core::ResourceStatus& srv)
   // synchronizer.
   if (srv.request.status_code == trr::status_codes::FAILED)
   {
-    std::lock_guard<std::recursive_mutex> guard_acm(allocated_components_mutex_);
-    auto it = allocated_components_.find(srv.request.resource_id);
-    if (it == allocated_components_.end())
+    AllocationTracker::Component allocation;
+    if (!allocations_.findComponent(srv.request.resource_id, allocation))
     {
       return;
     }
 
-    if (it->second.first.isLocal())
+    if (allocation.component->isLocal())
     {
       TEMOTO_WARN("Local component failure detected, adjusting reliability.");
-      it->second.first.adjustReliability(0.0);
-      cir_->updateLocalComponent(it->second.first);
+      ComponentInfoPtr failed_component = std::make_shared<ComponentInfo>(*allocation.component);
+      failed_component->adjustReliability(0.0);
+      cir_->updateLocalComponent(*failed_component);
+      allocations_.updateComponent(srv.request.resource_id, failed_component);
     }
     else
     {
@@ -113,31 +170,22 @@ void ComponentManagerServers::statusCb2(temoto_core::ResourceStatus& srv)
   {
     TEMOTO_DEBUG("A resource, that a running pipe depends on, has failed");
 
-    int val = srv.request.resource_id;
-
-    auto it = std::find_if(allocated_pipes_hack_.begin(), allocated_pipes_hack_.end(),
-    [val](const std::pair<int, std::pair<PipeInfo, std::vector<int>>>& pair_in)
+    temoto_core::temoto_id::ID pipe_id;
+    AllocationTracker::Pipe allocation;
+    if (!allocations_.findPipeBySegment(srv.request.resource_id, pipe_id, allocation))
     {
-      for (const auto& client_id : pair_in.second.second)
-      {
-        if (client_id == val)
-        {
-          return true;
-        }
-      }
-      return false;
-    });
+      return;
+    }
 
-    if (it != allocated_pipes_hack_.end())
-    {
-      TEMOTO_INFO("Pipe of type '%s' (pipe size: %d) has stopped working"
-      , it->second.first.getType().c_str()
-      , it->second.first.getPipeSize());
+    TEMOTO_INFO("Pipe of type '%s' (pipe size: %d) has stopped working"
+    , allocation.pipe->getType().c_str()
+    , allocation.pipe->getPipeSize());
 
-      // Reduce the reliability of the pipe
-      it->second.first.reliability_.adjustReliability(0);
-      cir_->updatePipe(it->second.first);
-    }
+    // Reduce the reliability of the pipe
+    std::shared_ptr<PipeInfo> failed_pipe = std::make_shared<PipeInfo>(*allocation.pipe);
+    failed_pipe->reliability_.adjustReliability(0);
+    cir_->updatePipe(*failed_pipe);
+    allocations_.updatePipe(pipe_id, failed_pipe);
   }
   else if (srv.request.status_code == temoto_core::trr::status_codes::UPDATE)
   {
@@ -152,40 +200,46 @@ void ComponentManagerServers::statusCb2(temoto_core::ResourceStatus& srv)
  */
 bool ComponentManagerServers::listComponentsCb( ListComponents::Request& req, ListComponents::Response& res)
 {
+  // Work on a consistent snapshot of the registry
+  ComponentInfoRegistry::SnapshotPtr snapshot = cir_->getSnapshot();
+
   // Find the devices with the required type
-  for (const auto& component : cir_->getLocalComponents())
+  for (const auto& component : snapshot->local_components->getComponents())
   {
-    if (component.getType() == req.type || req.type.empty())
+    if (component->getType() == req.type || req.type.empty())
     {
       temoto_component_manager::Component comp_msg;
-      comp_msg.component_name = component.getName();
-      comp_msg.component_type = component.getType();
-      comp_msg.package_name = component.getPackageName();
-      comp_msg.temoto_namespace = component.getTemotoNamespace();
-      comp_msg.executable = component.getExecutable();
-      comp_msg.input_topics = component.getInputTopicsAsKeyVal();
-      comp_msg.output_topics = component.getOutputTopicsAsKeyVal();
-      comp_msg.required_parameters = component.getRequiredParametersAsKeyVal();
+      comp_msg.component_name = component->getName();
+      comp_msg.component_type = component->getType();
+      comp_msg.package_name = component->getPackageName();
+      comp_msg.temoto_namespace = component->getTemotoNamespace();
+      comp_msg.executable = component->getExecutable();
+      comp_msg.input_topics = component->getInputTopicsAsKeyVal();
+      comp_msg.output_topics = component->getOutputTopicsAsKeyVal();
+      comp_msg.required_parameters = component->getRequiredParametersAsKeyVal();
     
       res.local_components.push_back(comp_msg);
     }
   }
 
-  for (const auto& component : cir_->getRemoteComponents())
+  for (const auto& partition : *snapshot->remote_components)
   {
-    if (component.getType() == req.type || req.type.empty())
+    for (const auto& component : partition.second->getComponents())
     {
-      temoto_component_manager::Component comp_msg;
-      comp_msg.component_name = component.getName();
-      comp_msg.component_type = component.getType();
-      comp_msg.package_name = component.getPackageName();
-      comp_msg.temoto_namespace = component.getTemotoNamespace();
-      comp_msg.executable = component.getExecutable();
-      comp_msg.input_topics = component.getInputTopicsAsKeyVal();
-      comp_msg.output_topics = component.getOutputTopicsAsKeyVal();
-      comp_msg.required_parameters = component.getRequiredParametersAsKeyVal();
-    
-      res.remote_components.push_back(comp_msg);
+      if (component->getType() == req.type || req.type.empty())
+      {
+        temoto_component_manager::Component comp_msg;
+        comp_msg.component_name = component->getName();
+        comp_msg.component_type = component->getType();
+        comp_msg.package_name = component->getPackageName();
+        comp_msg.temoto_namespace = component->getTemotoNamespace();
+        comp_msg.executable = component->getExecutable();
+        comp_msg.input_topics = component->getInputTopicsAsKeyVal();
+        comp_msg.output_topics = component->getOutputTopicsAsKeyVal();
+        comp_msg.required_parameters = component->getRequiredParametersAsKeyVal();
+      
+        res.remote_components.push_back(comp_msg);
+      }
     }
   }
 
@@ -197,21 +251,27 @@ bool ComponentManagerServers::listComponentsCb( ListComponents::Request& req, Li
  */
 bool ComponentManagerServers::listPipesCb( ListPipes::Request& req, ListPipes::Response& res)
 {
+  ComponentInfoRegistry::SnapshotPtr snapshot = cir_->getSnapshot();
+
   // TODO: Find the pipes with the required type
-  for (const auto& pipe_category : cir_->getPipes())
+  for (const auto& pipe_category : snapshot->pipes->getCategories())
   {
-    for (const auto& pipe : pipe_category.second)
+    for (std::size_t position : pipe_category.second)
     {
+      const PipeInfoConstPtr& pipe = snapshot->pipes->getPipes()[position];
       Pipe pipe_msg;
-      pipe_msg.pipe_type = pipe.getType();
-      pipe_msg.pipe_name = pipe.getName();
+      pipe_msg.pipe_type = pipe->getType();
+      pipe_msg.pipe_name = pipe->getName();
+      pipe_msg.feasible = snapshot->pipes->isFeasible(position);
 
-      for (const auto& segment : pipe.getSegments())
+      for (const auto& segment : pipe->getSegments())
       {
         PipeSegment segment_msg;
         segment_msg.segment_type = segment.segment_type_;
-        segment_msg.required_parameters = std::vector<std::string>(
-          segment.required_parameters_.begin(), segment.required_parameters_.end());
+        for (Symbol parameter : segment.required_parameters_)
+        {
+          segment_msg.required_parameters.push_back(SymbolTable::keys().str(parameter));
+        }
         pipe_msg.segments.push_back(segment_msg);
       }
       res.pipe_infos.push_back(pipe_msg);
@@ -227,13 +287,61 @@ void ComponentManagerServers::loadComponentCb( LoadComponent::Request& req
                                              , LoadComponent::Response& res)
 {
   TEMOTO_DEBUG_STREAM("Received a request to load a component: \n" << req << std::endl);
+  warm_pool_.recordRequest(req.component_type);
+
+  // The components of a batch have been resolved by the batch already
+  ResolvedComponent resolved;
+  if (takeResolvedComponent(req, resolved))
+  {
+    loadResolvedComponent(req, res, resolved.local_candidates, resolved.remote_candidates);
+    return;
+  }
 
   // Try to find suitable candidate from local components
-  std::vector<ComponentInfo> l_cis;
-  std::vector<ComponentInfo> r_cis;
+  ComponentInfoConstPtrs l_cis;
+  ComponentInfoConstPtrs r_cis;
+  cir_->findLocalComponents(req, l_cis);
+  cir_->findRemoteComponents(req, r_cis);
 
-  bool got_local_components = cir_->findLocalComponents(req, l_cis);
-  bool got_remote_components = cir_->findRemoteComponents(req, r_cis);
+  ComponentInfoRegistry::QueryCacheStats cache_stats = cir_->getQueryCacheStats();
+  TEMOTO_DEBUG_STREAM("Component query cache: " << cache_stats.hits << " hits, "
+                      << cache_stats.misses << " misses, " << cache_stats.entries << " entries");
+
+  loadResolvedComponent(req, res, l_cis, r_cis);
+}
+
+/*
+ * ComponentManagerServers::takeResolvedComponent
+ */
+bool ComponentManagerServers::takeResolvedComponent(const LoadComponent::Request& req, ResolvedComponent& resolved)
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(resolved_components_mutex_);
+  if (resolved_components_.empty())
+  {
+    return false;
+  }
+
+  auto resolved_it = resolved_components_.find(ComponentInfoRegistry::queryCacheKey(req, true));
+  if (resolved_it == resolved_components_.end())
+  {
+    return false;
+  }
+  resolved = std::move(resolved_it->second);
+  resolved_components_.erase(resolved_it);
+  return true;
+}
+
+/*
+ * ComponentManagerServers::loadResolvedComponent
+ */
+void ComponentManagerServers::loadResolvedComponent( LoadComponent::Request& req
+                                                   , LoadComponent::Response& res
+                                                   , const ComponentInfoConstPtrs& l_cis
+                                                   , const ComponentInfoConstPtrs& r_cis)
+{
+  bool got_local_components = !l_cis.empty();
+  bool got_remote_components = !r_cis.empty();
 
   // Find the most reliable global component but do not forward the requests
   // that originate from other namespaces
@@ -249,7 +357,7 @@ void ComponentManagerServers::loadComponentCb( LoadComponent::Request& req
      * delays, etc. should also be considered when a component is chosen
      * from a remote namespace.
      */  
-    if (l_cis.at(0).getReliability() < r_cis.at(0).getReliability())
+    if (l_cis.at(0)->getReliability() < r_cis.at(0)->getReliability())
     {
       prefer_remote = true;
     }
@@ -265,24 +373,18 @@ void ComponentManagerServers::loadComponentCb( LoadComponent::Request& req
      * 
      * TODO: Add a feature (boolean) to allow components not to be "reused" like that
      */ 
-    temoto_er_manager::LoadExtResource load_er_msg;
-    temoto_core::temoto_id::ID alloc_comp_id = checkIfInUse(l_cis);
+    temoto_core::temoto_id::ID alloc_comp_id;
+    AllocationTracker::Component allocation;
 
-    if (alloc_comp_id != temoto_core::temoto_id::UNASSIGNED_ID)
+    // TODO: This is load of hacks because resource registrar does not maintain previous requests/responses
+    if (allocations_.findRunningComponent(l_cis, alloc_comp_id, allocation))
     {
       TEMOTO_DEBUG_STREAM("The given component is already in use but it is providing other data than requested."
        "Setting up a topic relay ...");
-      
-      std::lock_guard<std::recursive_mutex> guard_aerm(allocated_ext_resources_mutex_);
-      load_er_msg = allocated_ext_resources_.at(alloc_comp_id);
-      std::lock_guard<std::recursive_mutex> guard_acm(allocated_components_mutex_);
 
-      // TODO: This is load of hacks because resource registrar does not maintain previous requests/responses
-      ComponentInfo& alloc_comp_info = allocated_components_.at(alloc_comp_id).first;
-      LoadComponent::Response& alloc_comp_response = allocated_components_.at(alloc_comp_id).second;
-      temoto_core::TopicContainer alloc_comp_response_container;
-      alloc_comp_response_container.setInputTopicsByKeyValue(alloc_comp_response.input_topics);
-      alloc_comp_response_container.setOutputTopicsByKeyValue(alloc_comp_response.output_topics);
+      temoto_er_manager::LoadExtResource load_er_msg = allocation.load_er_msg;
+      const ComponentInfo& alloc_comp_info = *allocation.component;
+      const LoadComponent::Response& alloc_comp_response = allocation.res;
 
       try
       {
@@ -299,75 +401,7 @@ void ComponentManagerServers::loadComponentCb( LoadComponent::Request& req
 
         res.package_name = alloc_comp_info.getPackageName();
         res.executable = alloc_comp_info.getExecutable();
-        /*
-         * Set up the topics that are returned to the client
-         */
-
-        // Input topics 
-        for (const auto& input_topic : req.input_topics)
-        {
-          if (input_topic.value.empty())
-          {
-            // If the client did not ask the data to be remapped, then return the default topic
-            diagnostic_msgs::KeyValue in_tpc;
-            in_tpc.key = input_topic.key;
-            in_tpc.value = alloc_comp_response_container.getInputTopic(input_topic.key);
-            res.input_topics.push_back(in_tpc);
-          }
-          else
-          {
-            // Set up the remapper
-            temoto_er_manager::LoadExtResource load_er_msg_remapper;
-            load_er_msg_remapper.request.action = temoto_er_manager::action::ROS_EXECUTE;
-            load_er_msg_remapper.request.package_name = "topic_tools";
-            load_er_msg_remapper.request.executable = "relay";
-            load_er_msg_remapper.request.args = alloc_comp_response_container.getInputTopic(input_topic.key) + " " + input_topic.value;
-            
-            resource_registrar_1_.call<temoto_er_manager::LoadExtResource>( temoto_er_manager::srv_name::MANAGER
-                                                      , temoto_er_manager::srv_name::SERVER
-                                                      , load_er_msg_remapper
-                                                      , trr::FailureBehavior::NONE);
-
-            res.input_topics.push_back(input_topic);
-          }
-        }
-
-        // Output topics
-        if (req.output_topics.empty())
-        {
-          res.output_topics = alloc_comp_response.output_topics;
-          return;
-        }
-
-        for (const auto& output_topic : req.output_topics)
-        {
-          if (output_topic.value.empty())
-          {
-            // If the client did not ask the data to be remapped, then return the default topic
-            diagnostic_msgs::KeyValue out_tpc;
-            out_tpc.key = output_topic.key;
-            out_tpc.value = alloc_comp_response_container.getOutputTopic(output_topic.key);
-            res.output_topics.push_back(out_tpc);
-          }
-          else
-          {
-            // Set up the remapper
-            temoto_er_manager::LoadExtResource load_er_msg_remapper;
-            load_er_msg_remapper.request.action = temoto_er_manager::action::ROS_EXECUTE;
-            load_er_msg_remapper.request.package_name = "topic_tools";
-            load_er_msg_remapper.request.executable = "relay";
-            load_er_msg_remapper.request.args = alloc_comp_response_container.getOutputTopic(output_topic.key) + " " + output_topic.value;
-            TEMOTO_DEBUG_STREAM("key: " << output_topic.key << ". args: " << load_er_msg_remapper.request.args);
-
-            resource_registrar_1_.call<temoto_er_manager::LoadExtResource>(
-              temoto_er_manager::srv_name::MANAGER
-            , temoto_er_manager::srv_name::SERVER
-            , load_er_msg_remapper
-            , trr::FailureBehavior::NONE);
-
-            res.output_topics.push_back(output_topic);
-          }
-        }
+        connectToRunningComponent(req, res, alloc_comp_response);
         return;
       }
       catch(error::ErrorStack& error_stack)
@@ -377,11 +411,30 @@ void ComponentManagerServers::loadComponentCb( LoadComponent::Request& req
       }
     }
 
+    // Serve the request by an idle pre-launched instance if there is one
+    if (serveFromWarmPool(req, res, l_cis))
+    {
+      return;
+    }
+
     /*
-     * Loop through suitable local component candidates
+     * Loop through suitable local component candidates. In the hedged mode the most reliable
+     * candidates are raced against each other first
      */ 
-    for (ComponentInfo& ci : l_cis)
+    std::size_t first_candidate = 0;
+    if (hedged_launch_candidates_ > 1 && l_cis.size() > 1)
+    {
+      first_candidate = std::min<std::size_t>(hedged_launch_candidates_, l_cis.size());
+      if (launchHedged(req, res, ComponentInfoConstPtrs(l_cis.begin(), l_cis.begin() + first_candidate)))
+      {
+        return;
+      }
+    }
+
+    for (std::size_t i = first_candidate; i < l_cis.size(); i++)
     {
+      const ComponentInfo& ci = *l_cis[i];
+
       // Try to run the component via local Resource Manager
       temoto_er_manager::LoadExtResource load_er_msg;
       load_er_msg.request.action = temoto_er_manager::action::ROS_EXECUTE;
@@ -412,30 +465,12 @@ void ComponentManagerServers::loadComponentCb( LoadComponent::Request& req
         , trr::FailureBehavior::NONE);
 
         TEMOTO_DEBUG("Call to ProcessManager was sucessful.");
-
-        // Fill out the response about which particular component was chosen
-        res.package_name = ci.getPackageName();
-        res.executable = ci.getExecutable();
-
-        ci.adjustReliability(1.0);
-        cir_->updateLocalComponent(ci);
-
-        std::lock_guard<std::recursive_mutex> guard_acm(allocated_components_mutex_);
-        std::lock_guard<std::recursive_mutex> guard_aerm(allocated_ext_resources_mutex_);
-
-        allocated_components_.emplace(res.trr.resource_id, std::make_pair(ci, res));
-        allocated_ext_resources_.emplace(res.trr.resource_id, load_er_msg);
-
+        registerLocalComponent(ci, res, load_er_msg);
         return;
       }
       catch(error::ErrorStack& error_stack)
       {
-        if (error_stack.front().code != static_cast<int>(error::Code::SERVICE_REQ_FAIL))
-        {
-          ci.adjustReliability(0.0);
-          cir_->updateLocalComponent(ci);
-        }
-        SEND_ERROR(error_stack);
+        handleLocalComponentFailure(ci, error_stack);
       }
     }
   }
@@ -446,8 +481,10 @@ void ComponentManagerServers::loadComponentCb( LoadComponent::Request& req
   if (got_remote_components)
   {
     // Loop over suitable components
-    for (ComponentInfo& ci : r_cis)
+    for (const ComponentInfoConstPtr& candidate : r_cis)
     {
+      const ComponentInfo& ci = *candidate;
+
       // remote component candidate was found, forward the request to the remote component manager
       LoadComponent load_component_msg;
       load_component_msg.request.use_only_local_components = true;
@@ -475,8 +512,10 @@ void ComponentManagerServers::loadComponentCb( LoadComponent::Request& req
         TEMOTO_DEBUG("Call to remote ComponentManagerServers was sucessful.");
         res = load_component_msg.response;
 
-        std::lock_guard<std::recursive_mutex> guard_acm(allocated_components_mutex_);
-        allocated_components_.emplace(res.trr.resource_id, std::make_pair(ci, res));
+        AllocationTracker::Component allocation;
+        allocation.component = candidate;
+        allocation.res = res;
+        allocations_.addComponent(res.trr.resource_id, allocation);
       }
       catch(error::ErrorStack& error_stack)
       {
@@ -492,6 +531,447 @@ void ComponentManagerServers::loadComponentCb( LoadComponent::Request& req
   }
 }
 
+/*
+ * ComponentManagerServers::connectToRunningComponent
+ */
+void ComponentManagerServers::connectToRunningComponent( LoadComponent::Request& req
+                                                       , LoadComponent::Response& res
+                                                       , const LoadComponent::Response& alloc_comp_response)
+{
+  temoto_core::TopicContainer alloc_comp_response_container;
+  alloc_comp_response_container.setInputTopicsByKeyValue(alloc_comp_response.input_topics);
+  alloc_comp_response_container.setOutputTopicsByKeyValue(alloc_comp_response.output_topics);
+
+  /*
+   * Set up the topics that are returned to the client
+   */
+
+  // Input topics 
+  for (const auto& input_topic : req.input_topics)
+  {
+    if (input_topic.value.empty())
+    {
+      // If the client did not ask the data to be remapped, then return the default topic
+      diagnostic_msgs::KeyValue in_tpc;
+      in_tpc.key = input_topic.key;
+      in_tpc.value = alloc_comp_response_container.getInputTopic(input_topic.key);
+      res.input_topics.push_back(in_tpc);
+    }
+    else
+    {
+      // Relay the data that the client publishes to the topic that the component listens to
+      topic_relays_.addRelay( res.trr.resource_id
+                            , input_topic.value
+                            , alloc_comp_response_container.getInputTopic(input_topic.key));
+
+      res.input_topics.push_back(input_topic);
+    }
+  }
+
+  // Output topics
+  if (req.output_topics.empty())
+  {
+    res.output_topics = alloc_comp_response.output_topics;
+    return;
+  }
+
+  for (const auto& output_topic : req.output_topics)
+  {
+    if (output_topic.value.empty())
+    {
+      // If the client did not ask the data to be remapped, then return the default topic
+      diagnostic_msgs::KeyValue out_tpc;
+      out_tpc.key = output_topic.key;
+      out_tpc.value = alloc_comp_response_container.getOutputTopic(output_topic.key);
+      res.output_topics.push_back(out_tpc);
+    }
+    else
+    {
+      // Relay the data of the component to the topic that the client asked for
+      TEMOTO_DEBUG_STREAM("Relaying '" << output_topic.key << "' from '"
+                          << alloc_comp_response_container.getOutputTopic(output_topic.key)
+                          << "' to '" << output_topic.value << "'");
+
+      topic_relays_.addRelay( res.trr.resource_id
+                            , alloc_comp_response_container.getOutputTopic(output_topic.key)
+                            , output_topic.value);
+
+      res.output_topics.push_back(output_topic);
+    }
+  }
+}
+
+/*
+ * ComponentManagerServers::serveFromWarmPool
+ */
+bool ComponentManagerServers::serveFromWarmPool( LoadComponent::Request& req
+                                               , LoadComponent::Response& res
+                                               , const ComponentInfoConstPtrs& candidates)
+{
+  if (!warm_pool_.enabled())
+  {
+    return false;
+  }
+
+  // The idle instances run with the default parameters, hence requests for other values can not be served
+  ComponentInfoConstPtrs compatible_candidates;
+  for (const auto& candidate : candidates)
+  {
+    bool default_parameters = std::all_of( req.required_parameters.begin()
+                                         , req.required_parameters.end()
+                                         , [&candidate](const diagnostic_msgs::KeyValue& parameter)
+                                           {
+                                             return parameter.value.empty() ||
+                                                    parameter.value == candidate->getRequiredParameter(parameter.key);
+                                           });
+    if (default_parameters)
+    {
+      compatible_candidates.push_back(candidate);
+    }
+  }
+
+  WarmPool::Instance instance;
+  if (!warm_pool_.take(compatible_candidates, instance))
+  {
+    return false;
+  }
+
+  TEMOTO_DEBUG( "Serving the request by a pre-launched component: '%s', '%s'"
+  , instance.component->getPackageName().c_str()
+  , instance.component->getExecutable().c_str());
+
+  try
+  {
+    // As with the components in use, the External Resource Manager just increases the use count
+    temoto_er_manager::LoadExtResource load_er_msg;
+    load_er_msg.request = instance.load_er_msg.request;
+    resource_registrar_1_.call<temoto_er_manager::LoadExtResource>(
+      temoto_er_manager::srv_name::MANAGER
+    , temoto_er_manager::srv_name::SERVER
+    , load_er_msg
+    , trr::FailureBehavior::NONE);
+
+    connectToRunningComponent(req, res, instance.res);
+    res.required_parameters = instance.res.required_parameters;
+    registerLocalComponent(*instance.component, res, load_er_msg);
+  }
+  catch(error::ErrorStack& error_stack)
+  {
+    SEND_ERROR(error_stack);
+    releaseWarmInstance(instance);
+    return false;
+  }
+
+  // The component is held by the request now
+  releaseWarmInstance(instance);
+  return true;
+}
+
+/*
+ * ComponentManagerServers::releaseWarmInstance
+ */
+void ComponentManagerServers::releaseWarmInstance(const WarmPool::Instance& instance)
+{
+  try
+  {
+    resource_registrar_1_.unloadClientResource(instance.load_er_msg.response.trr.resource_id);
+  }
+  catch(error::ErrorStack& error_stack)
+  {
+    SEND_ERROR(error_stack);
+  }
+}
+
+/*
+ * ComponentManagerServers::warmPoolTimerCb
+ */
+void ComponentManagerServers::warmPoolTimerCb(const ros::TimerEvent& e)
+{
+  (void)e; // Suppress "unused parameter" compiler warnings
+
+  // Stop the instances of the types that are not requested anymore
+  for (const auto& instance : warm_pool_.takeCold())
+  {
+    TEMOTO_DEBUG_STREAM("Stopping the pre-launched '" << instance.component->getType() << "' component");
+    releaseWarmInstance(instance);
+  }
+
+  for (const std::string& component_type : warm_pool_.getTypesToWarm())
+  {
+    LoadComponent::Request req;
+    req.component_type = component_type;
+    ComponentInfoConstPtrs cis;
+    if (!cir_->findLocalComponents(req, cis))
+    {
+      continue;
+    }
+
+    // Launch the most reliable component with the default topics and parameters
+    WarmPool::Instance instance;
+    instance.component = cis.front();
+    const ComponentInfo& ci = *instance.component;
+    instance.load_er_msg.request.action = temoto_er_manager::action::ROS_EXECUTE;
+    instance.load_er_msg.request.package_name = ci.getPackageName();
+    instance.load_er_msg.request.executable = ci.getExecutable();
+    processTopics(req.input_topics, instance.res.input_topics, instance.load_er_msg, ci, "in");
+    processTopics(req.output_topics, instance.res.output_topics, instance.load_er_msg, ci, "out");
+    processParameters(req.required_parameters, instance.res.required_parameters, instance.load_er_msg, ci);
+
+    TEMOTO_DEBUG_STREAM("Pre-launching a '" << component_type << "' component: '"
+                        << ci.getPackageName() << "', '" << ci.getExecutable() << "'");
+    try
+    {
+      resource_registrar_1_.call<temoto_er_manager::LoadExtResource>(
+        temoto_er_manager::srv_name::MANAGER
+      , temoto_er_manager::srv_name::SERVER
+      , instance.load_er_msg
+      , trr::FailureBehavior::NONE);
+    }
+    catch(error::ErrorStack& error_stack)
+    {
+      handleLocalComponentFailure(ci, error_stack);
+      continue;
+    }
+
+    instance.res.package_name = ci.getPackageName();
+    instance.res.executable = ci.getExecutable();
+    if (!warm_pool_.add(instance))
+    {
+      releaseWarmInstance(instance);
+    }
+  }
+}
+
+/*
+ * ComponentManagerServers::registerLocalComponent
+ */
+void ComponentManagerServers::registerLocalComponent( const ComponentInfo& ci
+                                                    , LoadComponent::Response& res
+                                                    , const temoto_er_manager::LoadExtResource& load_er_msg)
+{
+  // Fill out the response about which particular component was chosen
+  res.package_name = ci.getPackageName();
+  res.executable = ci.getExecutable();
+
+  ComponentInfoPtr loaded_component = std::make_shared<ComponentInfo>(ci);
+  loaded_component->adjustReliability(1.0);
+  cir_->updateLocalComponent(*loaded_component);
+
+  AllocationTracker::Component allocation;
+  allocation.component = loaded_component;
+  allocation.res = res;
+  allocation.load_er_msg = load_er_msg;
+  allocation.local = true;
+  allocations_.addComponent(res.trr.resource_id, allocation);
+  TEMOTO_DEBUG_STREAM("'" << ci.getPackageName() << "', '" << ci.getExecutable() << "' has "
+                      << allocations_.getUseCount(ci) << " allocations");
+}
+
+/*
+ * ComponentManagerServers::handleLocalComponentFailure
+ */
+void ComponentManagerServers::handleLocalComponentFailure( const ComponentInfo& ci
+                                                         , error::ErrorStack& error_stack)
+{
+  if (error_stack.front().code != static_cast<int>(error::Code::SERVICE_REQ_FAIL))
+  {
+    ComponentInfo failed_component = ci;
+    failed_component.adjustReliability(0.0);
+    cir_->updateLocalComponent(failed_component);
+  }
+  SEND_ERROR(error_stack);
+}
+
+/*
+ * ComponentManagerServers::startHedgedLaunch
+ */
+std::shared_ptr<ComponentManagerServers::HedgedLaunch> ComponentManagerServers::startHedgedLaunch(
+  LoadComponent::Request& req
+, const LoadComponent::Response& res
+, const ComponentInfoConstPtr& candidate
+, std::shared_ptr<HedgedLaunchSignal> signal)
+{
+  const ComponentInfo& ci = *candidate;
+
+  // Each candidate gets its own response, as the remapped topics depend on the component
+  std::shared_ptr<HedgedLaunch> launch = std::make_shared<HedgedLaunch>();
+  launch->candidate = candidate;
+  launch->res = res;
+  launch->load_er_msg.request.action = temoto_er_manager::action::ROS_EXECUTE;
+  launch->load_er_msg.request.package_name = ci.getPackageName();
+  launch->load_er_msg.request.executable = ci.getExecutable();
+
+  processTopics(req.input_topics, launch->res.input_topics, launch->load_er_msg, ci, "in");
+  processTopics(req.output_topics, launch->res.output_topics, launch->load_er_msg, ci, "out");
+  processParameters(req.required_parameters, launch->res.required_parameters, launch->load_er_msg, ci);
+
+  TEMOTO_DEBUG( "Starting a hedged launch of a local component: '%s', '%s', reliability %.3f"
+  , ci.getPackageName().c_str()
+  , ci.getExecutable().c_str()
+  , ci.getReliability());
+
+  // The launch is owned by the caller until its future is consumed
+  HedgedLaunch* launch_ptr = launch.get();
+  launch->launch = std::async(std::launch::async, [this, launch_ptr, signal]
+  {
+    // The outcome is kept in the future, the signal only tells that there is one
+    auto report_finished = [&]
+    {
+      std::lock_guard<std::mutex> guard(signal->mutex);
+      signal->finished.push_back(launch_ptr);
+      signal->cv.notify_one();
+    };
+
+    try
+    {
+      resource_registrar_1_.call<temoto_er_manager::LoadExtResource>(
+        temoto_er_manager::srv_name::MANAGER
+      , temoto_er_manager::srv_name::SERVER
+      , launch_ptr->load_er_msg
+      , trr::FailureBehavior::NONE);
+    }
+    catch(...)
+    {
+      report_finished();
+      throw;
+    }
+    report_finished();
+  });
+  return launch;
+}
+
+/*
+ * ComponentManagerServers::launchHedged
+ */
+bool ComponentManagerServers::launchHedged( LoadComponent::Request& req
+                                          , LoadComponent::Response& res
+                                          , const ComponentInfoConstPtrs& candidates)
+{
+  const auto hedge_delay = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<double>(hedged_launch_delay_));
+  std::shared_ptr<HedgedLaunchSignal> signal = std::make_shared<HedgedLaunchSignal>();
+  std::vector<std::shared_ptr<HedgedLaunch>> launches;
+  std::shared_ptr<HedgedLaunch> winner;
+  std::size_t running = 0;
+  std::chrono::steady_clock::time_point last_start;
+
+  while (!winner && (running > 0 || launches.size() < candidates.size()))
+  {
+    // Start the next candidate if all previous ones failed or did not finish in time
+    if (launches.size() < candidates.size() &&
+        (running == 0 || std::chrono::steady_clock::now() - last_start >= hedge_delay))
+    {
+      launches.push_back(startHedgedLaunch(req, res, candidates[launches.size()], signal));
+      last_start = std::chrono::steady_clock::now();
+      running++;
+    }
+
+    // Sleep until a launch finishes or, if there are candidates left, the next one is due
+    std::vector<HedgedLaunch*> finished;
+    {
+      std::unique_lock<std::mutex> lock(signal->mutex);
+      auto has_finished = [&signal]
+      {
+        return !signal->finished.empty();
+      };
+
+      if (launches.size() < candidates.size())
+      {
+        signal->cv.wait_until(lock, last_start + hedge_delay, has_finished);
+      }
+      else
+      {
+        signal->cv.wait(lock, has_finished);
+      }
+      finished.swap(signal->finished);
+    }
+
+    for (HedgedLaunch* launch_ptr : finished)
+    {
+      const auto& launch = *std::find_if( launches.begin()
+                                        , launches.end()
+                                        , [launch_ptr](const std::shared_ptr<HedgedLaunch>& l)
+                                          {
+                                            return l.get() == launch_ptr;
+                                          });
+      launch->finished = true;
+      running--;
+      try
+      {
+        launch->launch.get();
+        winner = launch;
+        break;
+      }
+      catch(error::ErrorStack& error_stack)
+      {
+        handleLocalComponentFailure(*launch->candidate, error_stack);
+      }
+    }
+  }
+
+  /*
+   * The launches that are still going on can not be interrupted. They are unloaded via
+   * the External Resource Manager in the background once they return, so that the
+   * response is not held back by a slow candidate
+   */
+  std::vector<std::shared_ptr<HedgedLaunch>> losers;
+  for (const auto& launch : launches)
+  {
+    if (!launch->finished)
+    {
+      losers.push_back(launch);
+    }
+  }
+
+  if (!losers.empty())
+  {
+    // Lock the mutex
+    std::lock_guard<std::mutex> guard(hedged_cleanups_mutex_);
+    hedged_cleanups_.erase(std::remove_if( hedged_cleanups_.begin()
+                                         , hedged_cleanups_.end()
+                                         , [](const std::future<void>& cleanup)
+                                           {
+                                             return cleanup.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready;
+                                           })
+                         , hedged_cleanups_.end());
+
+    hedged_cleanups_.push_back(std::async(std::launch::async, [this, losers]
+    {
+      for (const auto& launch : losers)
+      {
+        try
+        {
+          launch->launch.get();
+        }
+        catch(error::ErrorStack& error_stack)
+        {
+          handleLocalComponentFailure(*launch->candidate, error_stack);
+          continue;
+        }
+
+        try
+        {
+          resource_registrar_1_.unloadClientResource(launch->load_er_msg.response.trr.resource_id);
+        }
+        catch(error::ErrorStack& error_stack)
+        {
+          SEND_ERROR(error_stack);
+        }
+      }
+    }));
+  }
+
+  if (!winner)
+  {
+    return false;
+  }
+
+  TEMOTO_DEBUG("Hedged launch of '%s' was sucessful.", winner->candidate->getExecutable().c_str());
+  res = winner->res;
+  registerLocalComponent(*winner->candidate, res, winner->load_er_msg);
+  return true;
+}
+
 /*
  * ComponentManagerServers::unloadComponentCb
  */
@@ -501,12 +981,11 @@ void ComponentManagerServers::unloadComponentCb( LoadComponent::Request& req
   // Suppress "unused parameter" compiler warnings
   (void)req;
   (void)res;
-  std::lock_guard<std::recursive_mutex> guard_acm(allocated_components_mutex_);
-  std::lock_guard<std::recursive_mutex> guard_aerm(allocated_ext_resources_mutex_);
 
   TEMOTO_DEBUG("received a request to stop component with id '%ld'", res.trr.resource_id);
-  allocated_components_.erase(res.trr.resource_id);
-  allocated_ext_resources_.erase(res.trr.resource_id);
+  allocations_.removeComponent(res.trr.resource_id);
+  topic_relays_.removeRelays(res.trr.resource_id);
+  TEMOTO_DEBUG_STREAM(topic_relays_.getRelayCount() << " topic relays are running");
   return;
 }
 
@@ -517,7 +996,7 @@ void ComponentManagerServers::loadPipeCb(LoadPipe::Request& req, LoadPipe::Respo
 {
   TEMOTO_DEBUG_STREAM("Received a request: \n" << req << std::endl);
 
-  PipeInfos pipes;
+  PipeInfoConstPtrs pipes;
 
   if (!cir_->findPipes(req, pipes))
   {
@@ -529,8 +1008,10 @@ void ComponentManagerServers::loadPipeCb(LoadPipe::Request& req, LoadPipe::Respo
   /*
    * Loop over all possible tracking methods until somethin starts to work
    */
-  for (PipeInfo& pipe : pipes)
+  for (const PipeInfoConstPtr& candidate : pipes)
   {
+    const PipeInfo& pipe = *candidate;
+
     TEMOTO_DEBUG_STREAM("Trying pipe: \n" << pipe.toString().c_str());
 
     try
@@ -541,107 +1022,287 @@ void ComponentManagerServers::loadPipeCb(LoadPipe::Request& req, LoadPipe::Respo
       // Create a new pipe id if it was not specified
       if (pipe_id.empty())
       {
-        // Create a unique pipe identifier string
+        // Create a unique pipe identifier string. The generator is shared by concurrent loads
+        std::lock_guard<std::mutex> guard(pipe_id_generator_mutex_);
         pipe_id = "pipe_" + std::to_string(pipe_id_generator_.generateID())
                 + "_at_" + temoto_core::common::getTemotoNamespace();
       }
 
       res.pipe_id = pipe_id;
 
-      /*
-       * Build the pipe based on the number of segments. If the pipe
-       * contains only one segment, then there are no constraints on
-       * the ouptut topic types. But if the pipe contains multiple segments
-       * then each preceding segment has to provide the topics that are
-       * required by the proceding segment
-       */
-      temoto_core::TopicContainer previous_segment_topics;
-
-      // Loop over the pipe
-      const std::vector<Segment>& segments = pipe.getSegments();
-
       // TODO: REMOVE AFTER RMP HAS THIS FUNCTIONALITY
       std::vector<int> sub_resource_ids;
 
-      for (unsigned int i=0; i<segments.size(); i++)
+      try
       {
-        // Declare a LoadComponent message
-        temoto_component_manager::LoadComponent load_component_msg;
-        load_component_msg.request.use_only_local_components = req.use_only_local_segments;
-        load_component_msg.request.component_type = segments.at(i).segment_type_;
-        temoto_core::TopicContainer required_topics;
-
-        // Set the input topics
-        for (const auto& topic_type : segments.at(i).required_input_topic_types_)
+        if (!concurrent_pipe_bringup_ || !bringUpSegmentsConcurrently(req, res, pipe, sub_resource_ids))
         {
-          required_topics.addInputTopic(topic_type, previous_segment_topics.getOutputTopic(topic_type)); 
+          bringUpSegmentsSequentially(req, res, pipe, sub_resource_ids);
         }
+      }
+      catch (temoto_core::error::ErrorStack& error_stack)
+      {
+        // Do not leave the segments of a half-built pipe running
+        rollBackSegments(sub_resource_ids);
+        throw FORWARD_ERROR(error_stack);
+      }
+      catch (...)
+      {
+        rollBackSegments(sub_resource_ids);
+        throw;
+      }
 
-        // Set the output topics. If it is not the last segment then ...
-        if (i != segments.size()-1)
-        {
-          // ... get the requirements for the output topic types from the proceding segment
-          for (const auto& topic_type : segments.at(i+1).required_input_topic_types_)
-          {
-            required_topics.addOutputTopic(topic_type, "/" + pipe_id + "/segment_" + std::to_string(i) + "/" + topic_type);
-          }
-        }
-        else
-        {
-          // ... get the requirements for the output topics from own output topic requirements
-          // TODO: throw if the "required_output_topic_types_" is empty
-          for (const auto& topic_type : segments.at(i).required_output_topic_types_)
-          {
-            required_topics.addOutputTopic(topic_type, "/" + pipe_id + "/segment_" + std::to_string(i) + "/" + topic_type);
-          }
-        }
+      // Add the pipe to allocated pipes + increase its reliability
+      std::shared_ptr<PipeInfo> loaded_pipe = std::make_shared<PipeInfo>(pipe);
+      loaded_pipe->reliability_.adjustReliability();
+      cir_->updatePipe(*loaded_pipe);
 
-        load_component_msg.request.input_topics = required_topics.inputTopicsAsKeyValues();
-        load_component_msg.request.output_topics = required_topics.outputTopicsAsKeyValues();
+      //allocated_pipes_[res.trr.resource_id] = pipe;
+      AllocationTracker::Pipe allocation;
+      allocation.pipe = loaded_pipe;
+      allocation.sub_resource_ids = sub_resource_ids;
+      allocations_.addPipe(res.trr.resource_id, allocation);
 
-        // Check if any parameters were specified for this segment
-        for (const auto& seg_param_spec : req.pipe_segment_specifiers)
-        {
-          if (seg_param_spec.segment_index == i)
-          {
-            load_component_msg.request.required_parameters = seg_param_spec.parameters;
-            load_component_msg.request.component_name = seg_param_spec.component_name;
-            break;
-          }
-        }
+      return;
+    }
+    catch (temoto_core::error::ErrorStack& error_stack)
+    {
+      // TODO: Make sure that send error add the name of the function where the error was sent
+      SEND_ERROR(error_stack);
+    }
+  }
+
+  throw CREATE_ERROR(temoto_core::error::Code::NO_TRACKERS_FOUND, "Could not find pipes for the requested category");
+}
+
+/*
+ * ComponentManagerServers::makeSegmentRequest
+ */
+LoadComponent ComponentManagerServers::makeSegmentRequest( const LoadPipe::Request& req
+                                                         , const LoadPipe::Response& res
+                                                         , const PipeInfo& pipe
+                                                         , unsigned int i
+                                                         , const temoto_core::TopicContainer& previous_segment_topics) const
+{
+  const std::vector<Segment>& segments = pipe.getSegments();
 
-        // Call the Component Manager
+  // Declare a LoadComponent message
+  temoto_component_manager::LoadComponent load_component_msg;
+  load_component_msg.request.use_only_local_components = req.use_only_local_segments;
+  load_component_msg.request.component_type = segments.at(i).segment_type_;
+  temoto_core::TopicContainer required_topics;
+
+  // Set the input topics
+  for (Symbol topic_type_symbol : segments.at(i).required_input_topic_types_)
+  {
+    const std::string& topic_type = SymbolTable::keys().str(topic_type_symbol);
+    required_topics.addInputTopic(topic_type, previous_segment_topics.getOutputTopic(topic_type)); 
+  }
+
+  // Set the output topics. If it is not the last segment then ...
+  if (i != segments.size()-1)
+  {
+    // ... get the requirements for the output topic types from the proceding segment
+    for (Symbol topic_type_symbol : segments.at(i+1).required_input_topic_types_)
+    {
+      const std::string& topic_type = SymbolTable::keys().str(topic_type_symbol);
+      required_topics.addOutputTopic(topic_type, "/" + res.pipe_id + "/segment_" + std::to_string(i) + "/" + topic_type);
+    }
+  }
+  else
+  {
+    // ... get the requirements for the output topics from own output topic requirements
+    // TODO: throw if the "required_output_topic_types_" is empty
+    for (Symbol topic_type_symbol : segments.at(i).required_output_topic_types_)
+    {
+      const std::string& topic_type = SymbolTable::keys().str(topic_type_symbol);
+      required_topics.addOutputTopic(topic_type, "/" + res.pipe_id + "/segment_" + std::to_string(i) + "/" + topic_type);
+    }
+  }
+
+  load_component_msg.request.input_topics = required_topics.inputTopicsAsKeyValues();
+  load_component_msg.request.output_topics = required_topics.outputTopicsAsKeyValues();
+
+  // Check if any parameters were specified for this segment
+  for (const auto& seg_param_spec : req.pipe_segment_specifiers)
+  {
+    if (seg_param_spec.segment_index == i)
+    {
+      load_component_msg.request.required_parameters = seg_param_spec.parameters;
+      load_component_msg.request.component_name = seg_param_spec.component_name;
+      break;
+    }
+  }
+
+  return load_component_msg;
+}
+
+/*
+ * ComponentManagerServers::bringUpSegmentsSequentially
+ */
+void ComponentManagerServers::bringUpSegmentsSequentially( const LoadPipe::Request& req
+                                                         , LoadPipe::Response& res
+                                                         , const PipeInfo& pipe
+                                                         , std::vector<int>& sub_resource_ids)
+{
+  /*
+   * Build the pipe based on the number of segments. If the pipe
+   * contains only one segment, then there are no constraints on
+   * the ouptut topic types. But if the pipe contains multiple segments
+   * then each preceding segment has to provide the topics that are
+   * required by the proceding segment
+   */
+  temoto_core::TopicContainer previous_segment_topics;
+
+  for (unsigned int i=0; i<pipe.getSegments().size(); i++)
+  {
+    LoadComponent load_component_msg = makeSegmentRequest(req, res, pipe, i, previous_segment_topics);
+
+    // Call the Component Manager
+    resource_registrar_2_.call<temoto_component_manager::LoadComponent>(temoto_component_manager::srv_name::MANAGER,
+                                                                      temoto_component_manager::srv_name::SERVER,
+                                                                      load_component_msg);
+
+    // TODO: REMOVE AFTER RMP HAS THIS FUNCTIONALITY
+    sub_resource_ids.push_back(load_component_msg.response.trr.resource_id);
+
+    previous_segment_topics.setInputTopicsByKeyValue(load_component_msg.response.input_topics);
+    previous_segment_topics.setOutputTopicsByKeyValue(load_component_msg.response.output_topics);
+  }
+
+  // Send the output topics of the last segment back via response
+  res.output_topics = previous_segment_topics.outputTopicsAsKeyValues();
+}
+
+/*
+ * ComponentManagerServers::bringUpSegmentsConcurrently
+ */
+bool ComponentManagerServers::bringUpSegmentsConcurrently( const LoadPipe::Request& req
+                                                         , LoadPipe::Response& res
+                                                         , const PipeInfo& pipe
+                                                         , std::vector<int>& sub_resource_ids)
+{
+  const std::vector<Segment>& segments = pipe.getSegments();
+  if (segments.empty())
+  {
+    return false;
+  }
+
+  /*
+   * The topics between the segments are named after the pipe, hence the input topics of
+   * each segment are known before the preceding segment is running
+   */
+  std::vector<LoadComponent> load_component_msgs;
+  temoto_core::TopicContainer previous_segment_topics;
+  for (unsigned int i=0; i<segments.size(); i++)
+  {
+    load_component_msgs.push_back(makeSegmentRequest(req, res, pipe, i, previous_segment_topics));
+    previous_segment_topics = temoto_core::TopicContainer();
+    previous_segment_topics.setOutputTopicsByKeyValue(load_component_msgs.back().request.output_topics);
+  }
+
+  // The first failure of any kind, rethrown once every started segment is accounted for
+  std::exception_ptr failure;
+  std::vector<std::future<void>> launches;
+  try
+  {
+    for (auto& load_component_msg : load_component_msgs)
+    {
+      launches.push_back(std::async(std::launch::async, [this, &load_component_msg]
+      {
         resource_registrar_2_.call<temoto_component_manager::LoadComponent>(temoto_component_manager::srv_name::MANAGER,
                                                                           temoto_component_manager::srv_name::SERVER,
                                                                           load_component_msg);
+      }));
+    }
+  }
+  catch (...)
+  {
+    failure = std::current_exception();
+  }
 
-        // TODO: REMOVE AFTER RMP HAS THIS FUNCTIONALITY
-        sub_resource_ids.push_back(load_component_msg.response.trr.resource_id);
-
-        previous_segment_topics.setInputTopicsByKeyValue(load_component_msg.response.input_topics);
-        previous_segment_topics.setOutputTopicsByKeyValue(load_component_msg.response.output_topics);
+  // Wait for every segment, so that all the running ones are known before anything is rolled back
+  for (unsigned int i=0; i<launches.size(); i++)
+  {
+    try
+    {
+      launches[i].get();
+      sub_resource_ids.push_back(load_component_msgs[i].response.trr.resource_id);
+    }
+    catch (...)
+    {
+      if (!failure)
+      {
+        failure = std::current_exception();
       }
+    }
+  }
 
-      // Send the output topics of the last segment back via response
-      res.output_topics = previous_segment_topics.outputTopicsAsKeyValues();
+  if (failure)
+  {
+    try
+    {
+      std::rethrow_exception(failure);
+    }
+    catch (temoto_core::error::ErrorStack& error_stack)
+    {
+      throw FORWARD_ERROR(error_stack);
+    }
+  }
 
-      // Add the pipe to allocated pipes + increase its reliability
-      pipe.reliability_.adjustReliability();
-      cir_->updatePipe(pipe);
+  /*
+   * A segment that is served by an already running component keeps the topics of that
+   * component. Then the succeeding segment listens to wrong topics and the pipe has to be
+   * built sequentially instead
+   */
+  for (unsigned int i=0; i<load_component_msgs.size()-1; i++)
+  {
+    const LoadComponent& load_component_msg = load_component_msgs[i];
+    for (const auto& requested_topic : load_component_msg.request.output_topics)
+    {
+      bool matches = std::any_of( load_component_msg.response.output_topics.begin()
+                                , load_component_msg.response.output_topics.end()
+                                , [&requested_topic](const diagnostic_msgs::KeyValue& topic)
+                                  {
+                                    return topic.key == requested_topic.key && topic.value == requested_topic.value;
+                                  });
+      if (!matches)
+      {
+        TEMOTO_DEBUG_STREAM("Segment " << i << " does not publish to '" << requested_topic.value
+                            << "', building the pipe sequentially");
+        rollBackSegments(sub_resource_ids);
+        sub_resource_ids.clear();
+        return false;
+      }
+    }
+  }
 
-      //allocated_pipes_[res.trr.resource_id] = pipe;
-      allocated_pipes_hack_[res.trr.resource_id] = std::pair<PipeInfo, std::vector<int>>(pipe, sub_resource_ids);
+  // Send the output topics of the last segment back via response
+  res.output_topics = load_component_msgs.back().response.output_topics;
+  return true;
+}
 
-      return;
+/*
+ * ComponentManagerServers::rollBackSegments
+ */
+void ComponentManagerServers::rollBackSegments(const std::vector<int>& sub_resource_ids)
+{
+  for (auto it = sub_resource_ids.rbegin(); it != sub_resource_ids.rend(); ++it)
+  {
+    try
+    {
+      resource_registrar_2_.unloadClientResource(*it);
     }
     catch (temoto_core::error::ErrorStack& error_stack)
     {
-      // TODO: Make sure that send error add the name of the function where the error was sent
       SEND_ERROR(error_stack);
     }
+    catch (...)
+    {
+      // Keep rolling back the rest of the segments
+      TEMOTO_ERROR_STREAM("Could not unload the segment with resource id " << *it);
+    }
   }
-
-  throw CREATE_ERROR(temoto_core::error::Code::NO_TRACKERS_FOUND, "Could not find pipes for the requested category");
 }
 
 /*
@@ -652,11 +1313,9 @@ void ComponentManagerServers::unloadPipeCb(LoadPipe::Request& req, LoadPipe::Res
   (void)req; // Suppress "unused parameter" compiler warnings
 
   // Remove the pipe from the list of allocated pipes
-  auto it = allocated_pipes_hack_.find(res.trr.resource_id);
-  if (it != allocated_pipes_hack_.end())
+  if (allocations_.removePipe(res.trr.resource_id))
   {
-    TEMOTO_DEBUG_STREAM("Erasing a pipe from the list of allocated pipes");
-    allocated_pipes_hack_.erase(it);
+    TEMOTO_DEBUG_STREAM("Erased a pipe from the list of allocated pipes");
   }
   else
   {
@@ -667,83 +1326,211 @@ void ComponentManagerServers::unloadPipeCb(LoadPipe::Request& req, LoadPipe::Res
 
 
 /*
- * ComponentManagerServers::processTopics
+ * ComponentManagerServers::loadComponentsCb
  */
-void ComponentManagerServers::processTopics( std::vector<diagnostic_msgs::KeyValue>& req_topics
-                                           , std::vector<diagnostic_msgs::KeyValue>& res_topics
-                                           , temoto_er_manager::LoadExtResource& load_er_msg
-                                           , ComponentInfo& component_info
-                                           , std::string direction)
+void ComponentManagerServers::loadComponentsCb(LoadComponents::Request& req, LoadComponents::Response& res)
 {
+  TEMOTO_DEBUG_STREAM("Received a request to load " << req.components.size() << " components");
+
+  std::vector<LoadComponent> load_component_msgs(req.components.size());
+  res.components.resize(req.components.size());
+
   /*
-   * Find out it this is a launch file or not. Remapping is different
-   * for executable types (launch files or executables)
+   * Resolve all components before launching any, so that the ones without candidates are
+   * reported without a round trip
    */
-  bool isLaunchFile;
-  std::regex rx(".*\\.launch$");
-  isLaunchFile = std::regex_match(component_info.getExecutable(), rx);
+  std::vector<std::size_t> resolved;
+  std::vector<ResolvedComponent> resolved_candidates;
+  for (std::size_t i = 0; i < req.components.size(); i++)
+  {
+    const ComponentRequest& component = req.components[i];
+    LoadComponent::Request& load_req = load_component_msgs[i].request;
+    load_req.component_name = component.component_name;
+    load_req.component_type = component.component_type;
+    load_req.package_name = component.package_name;
+    load_req.executable = component.executable;
+    load_req.use_only_local_components = component.use_only_local_components;
+    load_req.output_topics = component.output_topics;
+    load_req.input_topics = component.input_topics;
+    load_req.required_parameters = component.required_parameters;
+
+    ComponentInfoConstPtrs l_cis;
+    ComponentInfoConstPtrs r_cis;
+    cir_->findLocalComponents(load_req, l_cis);
+    cir_->findRemoteComponents(load_req, r_cis);
+    if (!l_cis.empty() || (!load_req.use_only_local_components && !r_cis.empty()))
+    {
+      resolved.push_back(i);
+      resolved_candidates.push_back(ResolvedComponent{0, std::move(l_cis), std::move(r_cis)});
+    }
+    else
+    {
+      res.components[i].error_message = "ComponentManagerServers did not find a suitable component.";
+    }
+  }
 
-  // Work with input or output topics
-  std::vector<StringPair> component_info_topics;
+  /*
+   * Each component still goes through the resource registrar so that it gets its own resource id,
+   * but the candidates resolved above are handed over to loadComponentCb instead of being looked
+   * up again. The launches run on a bounded number of threads
+   */
+  std::vector<std::exception_ptr> launch_errors(resolved.size());
+  std::atomic<std::size_t> next_launch(0);
+  auto launch_worker = [&]
+  {
+    for (std::size_t j = next_launch++; j < resolved.size(); j = next_launch++)
+    {
+      LoadComponent& load_component_msg = load_component_msgs[resolved[j]];
+      std::string resolved_key = ComponentInfoRegistry::queryCacheKey(load_component_msg.request, true);
+      uint64_t token;
+      {
+        // Lock the mutex
+        std::lock_guard<std::mutex> guard(resolved_components_mutex_);
+        token = next_resolved_token_++;
+        resolved_candidates[j].token = token;
+        resolved_components_.emplace(resolved_key, std::move(resolved_candidates[j]));
+      }
 
-  if (direction == "in")
+      try
+      {
+        resource_registrar_2_.call<LoadComponent>( srv_name::MANAGER
+                                                 , srv_name::SERVER
+                                                 , load_component_msg
+                                                 , trr::FailureBehavior::NONE);
+      }
+      catch (...)
+      {
+        launch_errors[j] = std::current_exception();
+      }
+
+      /*
+       * Drop the handoff if the call did not reach loadComponentCb, e.g. when the registrar reused
+       * an existing resource. The entry may have been taken by an identical request meanwhile
+       */
+      // Lock the mutex
+      std::lock_guard<std::mutex> guard(resolved_components_mutex_);
+      auto range = resolved_components_.equal_range(resolved_key);
+      for (auto it = range.first; it != range.second; ++it)
+      {
+        if (it->second.token == token)
+        {
+          resolved_components_.erase(it);
+          break;
+        }
+      }
+    }
+  };
+
+  std::size_t thread_count = std::min<std::size_t>(batch_thread_count_, resolved.size());
+  std::vector<std::thread> launch_threads;
+  for (std::size_t t = 1; t < thread_count; t++)
   {
-    component_info_topics = component_info.getInputTopics();
+    launch_threads.emplace_back(launch_worker);
   }
-  else if (direction == "out")
+  if (thread_count > 0)
   {
-    component_info_topics = component_info.getOutputTopics();
+    launch_worker();
   }
-
-  // First fill out the response message with the default topic names
-  for (const auto& topic : component_info_topics)
+  for (std::thread& launch_thread : launch_threads)
   {
-    diagnostic_msgs::KeyValue topic_msg;
-    topic_msg.key = topic.first;
-    topic_msg.value = common::getAbsolutePath(topic.second);
-    res_topics.push_back(topic_msg);
+    launch_thread.join();
   }
 
-  // If no topics were requested, then return a list of all topics this component publishes
-  if (req_topics.empty())
+  unsigned int loaded_count = 0;
+  for (std::size_t j = 0; j < resolved.size(); j++)
   {
-    return; 
+    ComponentResult& result = res.components[resolved[j]];
+    try
+    {
+      if (launch_errors[j])
+      {
+        std::rethrow_exception(launch_errors[j]);
+      }
+    }
+    catch (error::ErrorStack& error_stack)
+    {
+      result.error_message = error_stack.empty() ? "Unknown error" : error_stack.front().message;
+      SEND_ERROR(error_stack);
+      continue;
+    }
+    catch (std::exception& e)
+    {
+      result.error_message = e.what();
+      TEMOTO_ERROR_STREAM("Failed to load a component of the batch: " << e.what());
+      continue;
+    }
+    catch (...)
+    {
+      result.error_message = "Unknown error";
+      TEMOTO_ERROR_STREAM("Failed to load a component of the batch");
+      continue;
+    }
+
+    const LoadComponent::Response& load_res = load_component_msgs[resolved[j]].response;
+    result.success = true;
+    result.resource_id = load_res.trr.resource_id;
+    result.package_name = load_res.package_name;
+    result.executable = load_res.executable;
+    result.output_topics = load_res.output_topics;
+    result.input_topics = load_res.input_topics;
+    result.required_parameters = load_res.required_parameters;
+    loaded_count++;
   }
 
-  // Remap the input topics if requested
+  TEMOTO_DEBUG_STREAM("Loaded " << loaded_count << " out of " << req.components.size() << " components");
+}
+
+/*
+ * ComponentManagerServers::unloadComponentsCb
+ */
+void ComponentManagerServers::unloadComponentsCb(LoadComponents::Request& req, LoadComponents::Response& res)
+{
+  (void)req; // Suppress "unused parameter" compiler warnings
+  TEMOTO_DEBUG("Unloading a batch of %lu components", res.components.size());
+}
+
+/*
+ * ComponentManagerServers::processTopics
+ */
+void ComponentManagerServers::processTopics( std::vector<diagnostic_msgs::KeyValue>& req_topics
+                                           , std::vector<diagnostic_msgs::KeyValue>& res_topics
+                                           , temoto_er_manager::LoadExtResource& load_er_msg
+                                           , const ComponentInfo& component_info
+                                           , std::string direction)
+{
+  LaunchPlanConstPtr launch_plan = getLaunchPlan(component_info);
+  bool input = (direction == "in");
+
+  // First fill out the response message with the default topic names
+  const std::vector<diagnostic_msgs::KeyValue>& default_topics = input
+    ? launch_plan->getInputTopics()
+    : launch_plan->getOutputTopics();
+  std::size_t first_slot = res_topics.size();
+  res_topics.insert(res_topics.end(), default_topics.begin(), default_topics.end());
+
+  // Remap the topics if requested
   for (auto& req_topic : req_topics)
   {
-    // Find the topic from the filled out response message
-    auto res_topic = std::find_if(res_topics.begin(), res_topics.end(),
-      [req_topic](const auto rt)
-      {
-        if (req_topic.key == rt.key)
-        {
-          return true;
-        }
-        else
-        {
-          return false;
-        }
-      });
-
-    if (!req_topic.value.empty())
+    if (req_topic.value.empty())
     {
-      std::string default_topic = res_topic->value;
-      res_topic->value = common::getAbsolutePath(req_topic.value);
-      // Remap depending wether it is a launch file or excutable
-      std::string remap_arg;
-      if (isLaunchFile)
-      {
-        remap_arg = req_topic.key + ":=" + req_topic.value;
-      }
-      else
-      {
-        remap_arg = default_topic + ":=" + req_topic.value;
-      }
+      continue;
+    }
 
-      load_er_msg.request.args += remap_arg + " ";
+    int slot = input ? launch_plan->findInputTopic(req_topic.key) : launch_plan->findOutputTopic(req_topic.key);
+    if (slot < 0)
+    {
+      continue;
     }
+    diagnostic_msgs::KeyValue& res_topic = res_topics[first_slot + slot];
+
+    // Remap depending wether it is a launch file or excutable
+    std::string& args = load_er_msg.request.args;
+    args += launch_plan->isLaunchFile() ? req_topic.key : res_topic.value;
+    args += ":=";
+    args += req_topic.value;
+    args += " ";
+
+    res_topic.value = common::getAbsolutePath(req_topic.value);
   }
 }
 
@@ -753,30 +1540,17 @@ void ComponentManagerServers::processTopics( std::vector<diagnostic_msgs::KeyVal
 void ComponentManagerServers::processParameters( std::vector<diagnostic_msgs::KeyValue>& req_parameters
                                                , std::vector<diagnostic_msgs::KeyValue>& res_parameters
                                                , temoto_er_manager::LoadExtResource& load_er_msg
-                                               , ComponentInfo& component_info)
+                                               , const ComponentInfo& component_info)
 {
-  /*
-   * Find out it this is a launch file or not. Remapping is different
-   * for executable types (launch files or executables)
-   */
-  bool isLaunchFile;
-  std::regex rx(".*\\.launch$");
-  isLaunchFile = std::regex_match(component_info.getExecutable(), rx);
-  std::vector<StringPair> component_info_parameters = component_info.getRequiredParameters();
+  LaunchPlanConstPtr launch_plan = getLaunchPlan(component_info);
 
   // If no parameters were requested, then set the default value for the parameter
   if (req_parameters.empty())
   {
-    for (const auto& parameter : component_info_parameters)
-    {
-      diagnostic_msgs::KeyValue parameter_msg;
-      parameter_msg.key = parameter.first;
-      parameter_msg.value = parameter.second;
-      res_parameters.push_back(parameter_msg);
-
-      std::string remap_arg = parameter_msg.key + ":=" + parameter_msg.value;
-      load_er_msg.request.args += remap_arg + " ";
-    }
+    res_parameters.insert( res_parameters.end()
+                         , launch_plan->getParameters().begin()
+                         , launch_plan->getParameters().end());
+    load_er_msg.request.args += launch_plan->getDefaultParameterArgs();
     return;
   }
 
@@ -786,17 +1560,23 @@ void ComponentManagerServers::processParameters( std::vector<diagnostic_msgs::Ke
     // And return the input parameters via response
     diagnostic_msgs::KeyValue res_parameter;
     res_parameter.key = req_parameter.key;
-    std::string default_parameter_value = component_info.getRequiredParameter(req_parameter.key);
 
     if (req_parameter.value != "")
     {
-      std::string remap_arg = req_parameter.key + ":=" + req_parameter.value;
-      load_er_msg.request.args += remap_arg + " ";
+      std::string& args = load_er_msg.request.args;
+      args += req_parameter.key;
+      args += ":=";
+      args += req_parameter.value;
+      args += " ";
       res_parameter.value = req_parameter.value;
     }
     else
     {
-      res_parameter.value = default_parameter_value;
+      int slot = launch_plan->findParameter(req_parameter.key);
+      if (slot >= 0)
+      {
+        res_parameter.value = launch_plan->getParameters()[slot].value;
+      }
     }
 
     // Add the parameter to the response message
@@ -804,53 +1584,27 @@ void ComponentManagerServers::processParameters( std::vector<diagnostic_msgs::Ke
   }
 }
 
-temoto_core::temoto_id::ID ComponentManagerServers::checkIfInUse( const std::vector<ComponentInfo>& cis_to_check) const
+/*
+ * ComponentManagerServers::getLaunchPlan
+ */
+LaunchPlanConstPtr ComponentManagerServers::getLaunchPlan(const ComponentInfo& component_info)
 {
-  std::lock_guard<std::recursive_mutex> guard_acm(allocated_components_mutex_);
-  for (const ComponentInfo& ci : cis_to_check)
+  // The registry plans the local components when they are added, others are planned on the spot
+  if (component_info.getLaunchPlan())
   {
-    for (auto const& ac : allocated_components_)
-    {
-      if (ac.second.first.getPackageName() != ci.getPackageName())
-      {
-        continue;
-      }
-
-      if (ac.second.first.getExecutable() != ci.getExecutable())
-      {
-        continue;
-      }
-
-      return ac.first;
-    }
+    return component_info.getLaunchPlan();
   }
-  return temoto_core::temoto_id::UNASSIGNED_ID;
+  return std::make_shared<const LaunchPlan>(component_info);
 }
 
-void ComponentManagerServers::cirUpdateCallback(ComponentInfo component)
+void ComponentManagerServers::cirUpdateCallback(ComponentInfoConstPtr component)
 {
   TEMOTO_DEBUG_STREAM("A component was added or updated ...");
 
-  // make a copy of the allocated_components so that it will not be corrupted by other threads
-  std::map<temoto_core::temoto_id::ID, ComponentInfoResponse> allocated_components_cpy;
-  {
-    std::lock_guard<std::recursive_mutex> guard_acm(allocated_components_mutex_);
-    allocated_components_cpy = allocated_components_;
-  }
-
-  for (const auto allocated_component : allocated_components_cpy)
+  for (temoto_core::temoto_id::ID outdated_component_id : allocations_.findLessReliable(*component))
   {
-    if (component.getType() != allocated_component.second.first.getType())
-    {
-      continue;
-    }
-    if (component.getReliability() <= allocated_component.second.first.getReliability())
-    {
-      continue;
-    }
-
     temoto_core::ResourceStatus status_message;
-    status_message.request.resource_id = allocated_component.first;
+    status_message.request.resource_id = outdated_component_id;
     status_message.request.status_code = trr::status_codes::UPDATE;
     status_message.request.message = "A component that is currently loaded got a more reliable alternative component";
     resource_registrar_1_.sendStatus(status_message);
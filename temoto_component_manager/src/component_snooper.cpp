@@ -21,12 +21,47 @@
 
 #include "ros/package.h"
 #include "yaml-cpp/yaml.h"
+#include <algorithm>
+#include <functional>
 
 
 namespace temoto_component_manager
 {
 using namespace temoto_core;
 
+namespace
+{
+
+/**
+ * @brief Runs a function object when a callback queue gets to it
+ */
+class FunctionCallback : public ros::CallbackInterface
+{
+public:
+  explicit FunctionCallback(std::function<void()> function)
+  : function_(std::move(function))
+  {}
+
+  CallResult call() override
+  {
+    function_();
+    return Success;
+  }
+
+private:
+  std::function<void()> function_;
+};
+
+int getSyncThreadCount()
+{
+  ros::NodeHandle nh_private("~");
+  int thread_count;
+  nh_private.param<int>("threads/sync", thread_count, 1);
+  return std::max(thread_count, 1);
+}
+
+} // anonymous namespace
+
 // TODO: the constructor of the action_engine_ can throw in the initializer list
 //       and I have no clue what kind of behaviour should be expected - prolly bad
 
@@ -36,6 +71,7 @@ ComponentSnooper::ComponentSnooper( temoto_core::BaseSubsystem*b
 , config_syncer_(srv_name::MANAGER, srv_name::SYNC_TOPIC, &ComponentSnooper::syncCb, this)
 , action_engine_()
 , cir_(cir)
+, snooper_spinner_(getSyncThreadCount(), &snooper_queue_)
 {
   // Set up the action engine
   std::string action_uri_file_path = ros::package::getPath(ROS_PACKAGE_NAME) + "/config/action_dst.yaml";
@@ -58,6 +94,7 @@ ComponentSnooper::ComponentSnooper( temoto_core::BaseSubsystem*b
   action_engine_.start();
 
   // Component Info update monitoring timer
+  nh_.setCallbackQueue(&snooper_queue_);
   update_monitoring_timer_ = nh_.createTimer(ros::Duration(1), &ComponentSnooper::updateMonitoringTimerCb, this);
 
   // Get remote component_infos
@@ -65,6 +102,8 @@ ComponentSnooper::ComponentSnooper( temoto_core::BaseSubsystem*b
 
   // Advertise local components
   advertiseLocalComponents();
+
+  snooper_spinner_.start();
 }
 
 void ComponentSnooper::startSnooping()
@@ -133,15 +172,19 @@ void ComponentSnooper::advertiseComponent(ComponentInfo& si) const
 void ComponentSnooper::advertiseLocalComponents() const
 {
   // publish all local components
+  ComponentInfoRegistry::SnapshotPtr snapshot = cir_->getSnapshot();
   YAML::Node config;
-  for(const auto& s : cir_->getLocalComponents())
+  for(const auto& s : snapshot->local_components->getComponents())
   {
-    config["Components"].push_back(s);
+    config["Components"].push_back(*s);
   }
 
   // send to other managers if there is anything to send
   if(config.size())
   {
+    // Lets the other managers drop the components that are not advertised anymore
+    config["FullAdvertisement"] = true;
+
     PayloadType payload;
     payload.data = Dump(config);
     config_syncer_.advertise(payload);
@@ -167,6 +210,9 @@ std::vector<ComponentInfoPtr> ComponentSnooper::parseComponents(const YAML::Node
 
   TEMOTO_DEBUG("Parsing %lu components.", components_node.size());
 
+  // The components parsed so far, for detecting duplicates
+  ComponentInfoConstPtrSet parsed_components;
+
   // go over each component node in the sequence
   for (YAML::const_iterator node_it = components_node.begin(); node_it != components_node.end(); ++node_it)
   {
@@ -179,17 +225,16 @@ std::vector<ComponentInfoPtr> ComponentSnooper::parseComponents(const YAML::Node
 
     try
     {
-      ComponentInfo component = node_it->as<ComponentInfo>();
-      if (std::count_if(components.begin(), components.end(),
-                        [&](const ComponentInfoPtr& s) { return *s == component; }) == 0)
+      ComponentInfoPtr component = std::make_shared<ComponentInfo>(node_it->as<ComponentInfo>());
+      if (parsed_components.insert(component).second)
       {
         // OK, this is unique pointer, add it to the components vector.
-        components.emplace_back(std::make_shared<ComponentInfo>(component));
+        components.push_back(component);
         //TEMOTO_DEBUG_STREAM("####### PARSED COMPONENT: #######\n" << components.back()->toString());
       }
       else
       {
-        TEMOTO_WARN("Ignoring duplicate of component '%s'.", component.getName().c_str());
+        TEMOTO_WARN("Ignoring duplicate of component '%s'.", component->getName().c_str());
       }
     }
     catch (YAML::TypedBadConversion<ComponentInfo> e)
@@ -203,7 +248,13 @@ std::vector<ComponentInfoPtr> ComponentSnooper::parseComponents(const YAML::Node
 
 void ComponentSnooper::syncCb(const temoto_core::ConfigSync& msg, const PayloadType& payload)
 {
+  // The synchronizer subscribes on the global queue, hence the message is processed on the queue of the snooper
+  snooper_queue_.addCallback(boost::make_shared<FunctionCallback>(
+    std::bind(&ComponentSnooper::processSync, this, msg, payload)));
+}
 
+void ComponentSnooper::processSync(const temoto_core::ConfigSync& msg, const PayloadType& payload)
+{
   if (msg.action == trr::sync_action::REQUEST_CONFIG)
   {
     std::cout << "Received a request to advertise local components" << std::endl;
@@ -219,26 +270,27 @@ void ComponentSnooper::syncCb(const temoto_core::ConfigSync& msg, const PayloadT
     YAML::Node config = YAML::Load(payload.data);
     std::vector<ComponentInfoPtr> components = parseComponents(config);
 
-    // TODO: Hold remote stuff in a map or something keyed by namespace
-    // TODO: Temoto namespace can (doesn't have to) be contained in config
+    // The components are kept in a partition of the advertising manager's namespace
+    std::vector<ComponentInfo> remote_components;
+    remote_components.reserve(components.size());
     for (auto& s : components)
     {
       s->setTemotoNamespace(msg.temoto_namespace);
       TEMOTO_WARN("---------REMOTE COMPONENT: \n %s", s->toString().c_str());
+      remote_components.push_back(*s);
     }
 
-    for (auto& component : components)
+    // A full advertisement contains all components of the remote manager, hence it replaces
+    // the partition. Otherwise the advertised components are added or updated
+    if (config["FullAdvertisement"] && config["FullAdvertisement"].as<bool>())
     {
-      // Check if component has to be added or updated
-      if (cir_->updateRemoteComponent(*component))
-      {
-        TEMOTO_DEBUG("Updating remote component '%s' at '%s'.", component->getName().c_str(),
-                     component->getTemotoNamespace().c_str());
-      }
-      else
-      {
-        cir_->addRemoteComponent(*component);
-      }
+      TEMOTO_DEBUG("Replacing the remote components of '%s'.", msg.temoto_namespace.c_str());
+      cir_->replaceRemoteComponents(msg.temoto_namespace, remote_components);
+    }
+    else
+    {
+      TEMOTO_DEBUG("Adding or updating remote components of '%s'.", msg.temoto_namespace.c_str());
+      cir_->mergeRemoteComponents(msg.temoto_namespace, remote_components);
     }
   }
 }
@@ -247,16 +299,59 @@ void ComponentSnooper::updateMonitoringTimerCb(const ros::TimerEvent& e)
 {
   (void)e; // Suppress "unused variable" compiler warnings
 
-  // Iterate through local components and check if their reliability has been updated
-  for (const auto component : cir_->getLocalComponents())
+  // Check only the local components that have changed since the last check
+  std::vector<ComponentInfo> unadvertised_components;
+  std::vector<ComponentInfoRegistry::ComponentChange> changes;
+  ComponentInfoConstPtrSet seen_components;
+  if (cir_->getChangesSince(checked_generation_, changes))
   {
-    if (!component.getAdvertised())
+    // Go from the newest to the oldest change so that only the latest state of a component is used
+    for (auto change_it = changes.rbegin(); change_it != changes.rend(); change_it++)
     {
-      ComponentInfo si = component;
-      cir_->updateLocalComponent(si, true);
-      advertiseComponent(si);
+      checked_generation_ = std::max(checked_generation_, change_it->generation);
+      if (!change_it->local)
+      {
+        continue;
+      }
+
+      if (!seen_components.insert(change_it->component).second)
+      {
+        continue;
+      }
+
+      const ComponentInfo& component = *change_it->component;
+
+      if (change_it->kind != ComponentInfoRegistry::ComponentChange::REMOVED && !component.getAdvertised())
+      {
+        unadvertised_components.push_back(component);
+      }
     }
   }
+  else
+  {
+    // The change log does not reach back to the last check, hence fall back to a full scan. The
+    // snapshot is published together with its log entries, so the next check continues from its version
+    ComponentInfoRegistry::SnapshotPtr snapshot = cir_->getSnapshot();
+    checked_generation_ = snapshot->version;
+    for (const auto& component : snapshot->local_components->getComponents())
+    {
+      if (!component->getAdvertised())
+      {
+        unadvertised_components.push_back(*component);
+      }
+    }
+  }
+
+  if (unadvertised_components.empty())
+  {
+    return;
+  }
+
+  cir_->updateLocalComponents(unadvertised_components, true);
+  for (auto& component : unadvertised_components)
+  {
+    advertiseComponent(component);
+  }
 }
 
 ComponentSnooper::~ComponentSnooper()
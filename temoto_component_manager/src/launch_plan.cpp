@@ -0,0 +1,82 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Author: Robert Valner */
+
+#include "temoto_component_manager/launch_plan.h"
+#include "temoto_core/common/tools.h"
+
+namespace temoto_component_manager
+{
+
+LaunchPlan::LaunchPlan(const ComponentInfo& ci)
+{
+  // Same as matching ".*\.launch$"
+  const std::string launch_suffix = ".launch";
+  const std::string& executable = ci.getExecutable();
+  is_launch_file_ = executable.size() >= launch_suffix.size() &&
+                    executable.compare(executable.size() - launch_suffix.size(), launch_suffix.size(), launch_suffix) == 0;
+
+  fill(ci.getInputTopics(), true, input_topics_, input_topic_slots_);
+  fill(ci.getOutputTopics(), true, output_topics_, output_topic_slots_);
+  fill(ci.getRequiredParameters(), false, parameters_, parameter_slots_);
+
+  for (const auto& parameter : parameters_)
+  {
+    default_parameter_args_ += parameter.key + ":=" + parameter.value + " ";
+  }
+}
+
+int LaunchPlan::findInputTopic(const std::string& topic_type) const
+{
+  return findSlot(input_topic_slots_, topic_type);
+}
+
+int LaunchPlan::findOutputTopic(const std::string& topic_type) const
+{
+  return findSlot(output_topic_slots_, topic_type);
+}
+
+int LaunchPlan::findParameter(const std::string& parameter) const
+{
+  return findSlot(parameter_slots_, parameter);
+}
+
+void LaunchPlan::fill( const std::vector<temoto_core::StringPair>& pairs
+                     , bool absolute
+                     , std::vector<diagnostic_msgs::KeyValue>& key_values
+                     , SlotMap& slots)
+{
+  key_values.reserve(pairs.size());
+  for (const auto& pair : pairs)
+  {
+    diagnostic_msgs::KeyValue key_value;
+    key_value.key = pair.first;
+    key_value.value = absolute ? temoto_core::common::getAbsolutePath(pair.second) : pair.second;
+
+    // The first one of the same type is the one that gets remapped
+    slots.emplace(key_value.key, key_values.size());
+    key_values.push_back(key_value);
+  }
+}
+
+int LaunchPlan::findSlot(const SlotMap& slots, const std::string& key)
+{
+  const auto slot_it = slots.find(key);
+  return (slot_it != slots.end()) ? slot_it->second : -1;
+}
+
+} // component_manager namespace
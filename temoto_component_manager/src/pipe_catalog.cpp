@@ -0,0 +1,371 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Author: Robert Valner */
+
+#include "temoto_component_manager/pipe_catalog.h"
+#include <algorithm>
+#include <functional>
+
+namespace temoto_component_manager
+{
+
+const PipeInfoConstPtrs& PipeCatalog::getPipes() const
+{
+  return pipes_;
+}
+
+const std::map<std::string, PipeCatalog::Bucket>& PipeCatalog::getCategories() const
+{
+  return by_category_;
+}
+
+const PipeCatalog::Bucket* PipeCatalog::findByCategory(const std::string& category) const
+{
+  const auto it = by_category_.find(category);
+  if (it == by_category_.end())
+  {
+    return NULL;
+  }
+  return &it->second;
+}
+
+int PipeCatalog::findByName(const std::string& name) const
+{
+  const auto it = by_name_.find(name);
+  if (it == by_name_.end())
+  {
+    return -1;
+  }
+  return it->second;
+}
+
+const PipeCatalog::Bucket* PipeCatalog::findBySegmentType(Symbol segment_type) const
+{
+  const auto it = by_segment_type_.find(segment_type);
+  if (it == by_segment_type_.end())
+  {
+    return NULL;
+  }
+  return &it->second;
+}
+
+bool PipeCatalog::findByOutputTopicTypes( const std::string& category
+                                        , const std::vector<Symbol>& topic_types
+                                        , Bucket& candidates ) const
+{
+  candidates.clear();
+  auto collect = [&candidates](const Bucket& bucket)
+  {
+    candidates.insert(candidates.end(), bucket.begin(), bucket.end());
+  };
+
+  const auto without_it = without_output_topics_.find(category);
+  if (without_it != without_output_topics_.end())
+  {
+    collect(without_it->second);
+  }
+
+  for (Symbol topic_type : topic_types)
+  {
+    const auto output_it = by_output_topic_type_.find(std::make_pair(category, topic_type));
+    if (output_it != by_output_topic_type_.end())
+    {
+      collect(output_it->second);
+    }
+  }
+
+  /*
+   * Restore the order of the category, which is by decreasing reliability and then by the order
+   * of indexing. A pipe that provides several of the types was collected more than once
+   */
+  std::sort( candidates.begin()
+           , candidates.end()
+           , [this](std::size_t l, std::size_t r)
+             {
+               float l_reliability = pipes_[l]->reliability_.getReliability();
+               float r_reliability = pipes_[r]->reliability_.getReliability();
+               if (l_reliability != r_reliability)
+               {
+                 return l_reliability > r_reliability;
+               }
+               return index_sequences_[l] < index_sequences_[r];
+             });
+  candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+  return !candidates.empty();
+}
+
+PipeInfoConstPtr PipeCatalog::find(const PipeInfo& pi) const
+{
+  int position = findPosition(pi);
+  if (position < 0)
+  {
+    return NULL;
+  }
+  return pipes_[position];
+}
+
+const SymbolMask& PipeCatalog::getOutputTopicTypes(std::size_t position) const
+{
+  return output_topic_types_[position];
+}
+
+bool PipeCatalog::isFeasible(std::size_t position) const
+{
+  return feasible_[position];
+}
+
+void PipeCatalog::setFeasible(std::size_t position, bool feasible)
+{
+  feasible_[position] = feasible;
+}
+
+bool PipeCatalog::add(PipeInfoConstPtr pi)
+{
+  if (findPosition(*pi) >= 0)
+  {
+    return false;
+  }
+
+  pipes_.push_back(std::move(pi));
+  output_topic_types_.emplace_back();
+  content_hashes_.push_back(0);
+  feasible_.push_back(false);
+  index_sequences_.push_back(0);
+  insertIntoIndexes(pipes_.size() - 1);
+  return true;
+}
+
+bool PipeCatalog::update(PipeInfoConstPtr pi)
+{
+  int position = findPosition(*pi);
+  if (position < 0)
+  {
+    return false;
+  }
+
+  // The contents stay the same but the name and the reliability might have changed
+  eraseFromIndexes(position);
+  pipes_[position] = std::move(pi);
+  insertIntoIndexes(position);
+  return true;
+}
+
+bool PipeCatalog::remove(const PipeInfo& pi)
+{
+  int position = findPosition(pi);
+  if (position < 0)
+  {
+    return false;
+  }
+
+  // Move the last pipe into the freed position so that the other positions stay valid
+  std::size_t last = pipes_.size() - 1;
+  eraseFromIndexes(position);
+  if (std::size_t(position) != last)
+  {
+    eraseFromIndexes(last);
+    pipes_[position] = std::move(pipes_[last]);
+    feasible_[position] = feasible_[last];
+    insertIntoIndexes(position);
+  }
+  pipes_.pop_back();
+  output_topic_types_.pop_back();
+  content_hashes_.pop_back();
+  feasible_.pop_back();
+  index_sequences_.pop_back();
+  return true;
+}
+
+uint64_t PipeCatalog::contentHash(const PipeInfo& pi)
+{
+  // Covers the same fields as operator== of PipeInfo
+  std::hash<std::string> hash_string;
+  uint64_t hash = hash_string(pi.getType());
+  auto combine = [&hash](uint64_t value)
+  {
+    hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+  };
+
+  for (const auto& segment : pi.getSegments())
+  {
+    combine(hash_string(segment.segment_type_));
+    for (const SymbolSet* field : { &segment.required_input_topic_types_
+                                  , &segment.required_output_topic_types_
+                                  , &segment.required_parameters_ })
+    {
+      combine(field->size());
+      for (Symbol value : *field)
+      {
+        combine(value);
+      }
+    }
+  }
+  return hash;
+}
+
+std::vector<Symbol> PipeCatalog::segmentTypes(const PipeInfo& pi)
+{
+  // Each type is listed once, even if multiple segments share it
+  std::vector<Symbol> segment_types;
+  for (const auto& segment : pi.getSegments())
+  {
+    segment_types.push_back(SymbolTable::identifiers().intern(segment.segment_type_));
+  }
+  std::sort(segment_types.begin(), segment_types.end());
+  segment_types.erase(std::unique(segment_types.begin(), segment_types.end()), segment_types.end());
+  return segment_types;
+}
+
+int PipeCatalog::findPosition(const PipeInfo& pi) const
+{
+  const auto bucket_it = by_content_.find(contentHash(pi));
+  if (bucket_it == by_content_.end())
+  {
+    return -1;
+  }
+
+  for (std::size_t position : bucket_it->second)
+  {
+    if (*pipes_[position] == pi)
+    {
+      return position;
+    }
+  }
+  return -1;
+}
+
+void PipeCatalog::insertByReliability(Bucket& bucket, std::size_t position) const
+{
+  float reliability = pipes_[position]->reliability_.getReliability();
+  auto insert_it = std::upper_bound( bucket.begin()
+                                   , bucket.end()
+                                   , reliability
+                                   , [this](float r, std::size_t p)
+                                     {
+                                       return r > pipes_[p]->reliability_.getReliability();
+                                     });
+  bucket.insert(insert_it, position);
+}
+
+void PipeCatalog::eraseFromBucket(Bucket& bucket, std::size_t position)
+{
+  bucket.erase(std::remove(bucket.begin(), bucket.end(), position), bucket.end());
+}
+
+void PipeCatalog::insertIntoIndexes(std::size_t position)
+{
+  const PipeInfo& pi = *pipes_[position];
+  index_sequences_[position] = next_index_sequence_++;
+
+  // Insert after all pipes of the category that are at least as reliable
+  insertByReliability(by_category_[pi.getType()], position);
+
+  if (!pi.getName().empty())
+  {
+    by_name_[pi.getName()] = position;
+  }
+
+  content_hashes_[position] = contentHash(pi);
+  by_content_[content_hashes_[position]].push_back(position);
+
+  for (Symbol segment_type : segmentTypes(pi))
+  {
+    by_segment_type_[segment_type].push_back(position);
+  }
+
+  // The output topic type buckets follow the insertion rule of the category bucket
+  SymbolMask output_topic_types;
+  bool has_output_topics = false;
+  if (!pi.getSegments().empty())
+  {
+    for (Symbol topic_type : pi.getSegments().back().required_output_topic_types_)
+    {
+      output_topic_types.insert(topic_type);
+      insertByReliability(by_output_topic_type_[std::make_pair(pi.getType(), topic_type)], position);
+      has_output_topics = true;
+    }
+  }
+  if (!has_output_topics)
+  {
+    insertByReliability(without_output_topics_[pi.getType()], position);
+  }
+  output_topic_types_[position] = output_topic_types;
+}
+
+void PipeCatalog::eraseFromIndexes(std::size_t position)
+{
+  const PipeInfo& pi = *pipes_[position];
+
+  auto category_it = by_category_.find(pi.getType());
+  Bucket& category = category_it->second;
+  category.erase(std::remove(category.begin(), category.end(), position), category.end());
+  if (category.empty())
+  {
+    by_category_.erase(category_it);
+  }
+
+  if (!pi.getName().empty())
+  {
+    by_name_.erase(pi.getName());
+  }
+
+  auto content_it = by_content_.find(content_hashes_[position]);
+  Bucket& content = content_it->second;
+  content.erase(std::remove(content.begin(), content.end(), position), content.end());
+  if (content.empty())
+  {
+    by_content_.erase(content_it);
+  }
+
+  for (Symbol segment_type : segmentTypes(pi))
+  {
+    auto segment_type_it = by_segment_type_.find(segment_type);
+    Bucket& segment_type_pipes = segment_type_it->second;
+    segment_type_pipes.erase( std::remove(segment_type_pipes.begin(), segment_type_pipes.end(), position)
+                            , segment_type_pipes.end());
+    if (segment_type_pipes.empty())
+    {
+      by_segment_type_.erase(segment_type_it);
+    }
+  }
+
+  bool has_output_topics = false;
+  if (!pi.getSegments().empty())
+  {
+    for (Symbol topic_type : pi.getSegments().back().required_output_topic_types_)
+    {
+      auto output_it = by_output_topic_type_.find(std::make_pair(pi.getType(), topic_type));
+      eraseFromBucket(output_it->second, position);
+      if (output_it->second.empty())
+      {
+        by_output_topic_type_.erase(output_it);
+      }
+      has_output_topics = true;
+    }
+  }
+  if (!has_output_topics)
+  {
+    auto without_it = without_output_topics_.find(pi.getType());
+    eraseFromBucket(without_it->second, position);
+    if (without_it->second.empty())
+    {
+      without_output_topics_.erase(without_it);
+    }
+  }
+}
+
+} // component_manager namespace
@@ -0,0 +1,439 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Author: Robert Valner */
+
+#include "temoto_component_manager/registry_snapshot.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace temoto_component_manager
+{
+
+namespace
+{
+
+/// "TCMR" in little endian
+const uint32_t SNAPSHOT_MAGIC = 0x524d4354;
+
+/// Incremented whenever the layout changes
+const uint32_t SNAPSHOT_FORMAT_VERSION = 1;
+
+/**
+ * @brief Appends fixed size values and length-prefixed strings to a byte buffer
+ */
+class SnapshotWriter
+{
+public:
+
+  void writeU32(uint32_t value)
+  {
+    buffer_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  void writeFloat(float value)
+  {
+    buffer_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  void writeString(const std::string& value)
+  {
+    writeU32(value.size());
+    buffer_.append(value);
+  }
+
+  void writeStringPairs(const std::vector<temoto_core::StringPair>& pairs)
+  {
+    writeU32(pairs.size());
+    for (const auto& pair : pairs)
+    {
+      writeString(pair.first);
+      writeString(pair.second);
+    }
+  }
+
+  /// Writes the strings of SymbolTable::keys(), the symbols themselves are not stable across runs
+  void writeKeys(const SymbolSet& keys)
+  {
+    writeU32(keys.size());
+    for (Symbol key : keys)
+    {
+      writeString(SymbolTable::keys().str(key));
+    }
+  }
+
+  const std::string& getBuffer() const
+  {
+    return buffer_;
+  }
+
+private:
+
+  std::string buffer_;
+};
+
+/**
+ * @brief Reads the values written by SnapshotWriter from a memory region. Every read is bounds
+ * checked, after the first failed read all following reads fail as well
+ */
+class SnapshotReader
+{
+public:
+
+  SnapshotReader(const char* begin, const char* end)
+  : pos_(begin)
+  , end_(end)
+  {}
+
+  bool readU32(uint32_t& value)
+  {
+    return readRaw(&value, sizeof(value));
+  }
+
+  bool readFloat(float& value)
+  {
+    return readRaw(&value, sizeof(value));
+  }
+
+  bool readString(std::string& value)
+  {
+    uint32_t size;
+    if (!readU32(size) || uint64_t(end_ - pos_) < size)
+    {
+      ok_ = false;
+      return false;
+    }
+    value.assign(pos_, size);
+    pos_ += size;
+    return true;
+  }
+
+  bool readStringPairs(std::vector<temoto_core::StringPair>& pairs)
+  {
+    uint32_t count;
+    if (!readU32(count))
+    {
+      return false;
+    }
+    for (uint32_t i=0; i<count; i++)
+    {
+      temoto_core::StringPair pair;
+      if (!readString(pair.first) || !readString(pair.second))
+      {
+        return false;
+      }
+      pairs.push_back(pair);
+    }
+    return true;
+  }
+
+  bool readKeys(SymbolSet& keys)
+  {
+    uint32_t count;
+    if (!readU32(count))
+    {
+      return false;
+    }
+    for (uint32_t i=0; i<count; i++)
+    {
+      std::string key;
+      if (!readString(key))
+      {
+        return false;
+      }
+      keys.insert(SymbolTable::keys().intern(key));
+    }
+    return true;
+  }
+
+  bool ok() const
+  {
+    return ok_;
+  }
+
+private:
+
+  bool readRaw(void* value, std::size_t size)
+  {
+    if (!ok_ || std::size_t(end_ - pos_) < size)
+    {
+      ok_ = false;
+      return false;
+    }
+    std::memcpy(value, pos_, size);
+    pos_ += size;
+    return true;
+  }
+
+  const char* pos_;
+  const char* end_;
+  bool ok_ = true;
+};
+
+bool readComponent(SnapshotReader& reader, ComponentInfo& component)
+{
+  std::string name, type, package_name, executable, description;
+  std::vector<temoto_core::StringPair> input_topics, output_topics, required_parameters;
+  float reliability;
+
+  if (!reader.readString(name) ||
+      !reader.readString(type) ||
+      !reader.readString(package_name) ||
+      !reader.readString(executable) ||
+      !reader.readString(description) ||
+      !reader.readFloat(reliability) ||
+      !reader.readStringPairs(input_topics) ||
+      !reader.readStringPairs(output_topics) ||
+      !reader.readStringPairs(required_parameters))
+  {
+    return false;
+  }
+
+  component.setName(name);
+  component.setType(type);
+  component.setPackageName(package_name);
+  component.setExecutable(executable);
+  component.setDescription(description);
+  component.resetReliability(reliability);
+  for (const auto& topic : input_topics)
+  {
+    component.addTopicIn(topic);
+  }
+  for (const auto& topic : output_topics)
+  {
+    component.addTopicOut(topic);
+  }
+  for (const auto& parameter : required_parameters)
+  {
+    component.addRequiredParameter(parameter);
+  }
+  return true;
+}
+
+bool readPipe(SnapshotReader& reader, PipeInfo& pipe)
+{
+  std::string type;
+  float reliability;
+  uint32_t segment_count;
+
+  if (!reader.readString(type) ||
+      !reader.readFloat(reliability) ||
+      !reader.readU32(segment_count))
+  {
+    return false;
+  }
+
+  std::vector<Segment> segments;
+  for (uint32_t i=0; i<segment_count; i++)
+  {
+    Segment segment;
+    if (!reader.readString(segment.segment_type_) ||
+        !reader.readKeys(segment.required_input_topic_types_) ||
+        !reader.readKeys(segment.required_output_topic_types_) ||
+        !reader.readKeys(segment.required_parameters_))
+    {
+      return false;
+    }
+    segments.push_back(segment);
+  }
+
+  pipe.setType(type);
+  pipe.setSegments(segments);
+  pipe.reliability_.resetReliability(reliability);
+  return true;
+}
+
+/**
+ * @brief Writes the whole buffer, retrying on short writes and interrupts
+ */
+bool writeAll(int fd, const char* data, std::size_t size)
+{
+  while (size > 0)
+  {
+    ssize_t written = ::write(fd, data, size);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+/**
+ * @brief Flushes the directory entries of the directory that contains \p path, so that a rename
+ * in it survives a power loss
+ */
+bool syncParentDirectory(const std::string& path)
+{
+  std::string::size_type slash = path.find_last_of('/');
+  std::string directory = (slash == std::string::npos) ? "." : path.substr(0, slash == 0 ? 1 : slash);
+
+  int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0)
+  {
+    return false;
+  }
+  bool synced = fsync(fd) == 0;
+  return (close(fd) == 0) && synced;
+}
+
+} // anonymous namespace
+
+bool RegistrySnapshotFile::write( const std::string& path
+                                , const ComponentInfoConstPtrs& components
+                                , const PipeInfoConstPtrs& pipes )
+{
+  SnapshotWriter writer;
+  writer.writeU32(SNAPSHOT_MAGIC);
+  writer.writeU32(SNAPSHOT_FORMAT_VERSION);
+
+  writer.writeU32(components.size());
+  for (const auto& component_ptr : components)
+  {
+    const ComponentInfo& component = *component_ptr;
+    writer.writeString(component.getName());
+    writer.writeString(component.getType());
+    writer.writeString(component.getPackageName());
+    writer.writeString(component.getExecutable());
+    writer.writeString(component.getDescription());
+    writer.writeFloat(component.getReliability());
+    writer.writeStringPairs(component.getInputTopics());
+    writer.writeStringPairs(component.getOutputTopics());
+    writer.writeStringPairs(component.getRequiredParameters());
+  }
+
+  writer.writeU32(pipes.size());
+  for (const auto& pipe_ptr : pipes)
+  {
+    const PipeInfo& pipe = *pipe_ptr;
+    writer.writeString(pipe.getType());
+    writer.writeFloat(pipe.reliability_.getReliability());
+    writer.writeU32(pipe.getSegments().size());
+    for (const auto& segment : pipe.getSegments())
+    {
+      writer.writeString(segment.segment_type_);
+      writer.writeKeys(segment.required_input_topic_types_);
+      writer.writeKeys(segment.required_output_topic_types_);
+      writer.writeKeys(segment.required_parameters_);
+    }
+  }
+
+  /*
+   * Write to a temporary file first, the rename replaces the old snapshot atomically. The file is
+   * synced before the rename and the directory after it, otherwise a power loss may leave an empty
+   * file in place of the last good snapshot
+   */
+  const std::string tmp_path = path + ".tmp";
+  int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  bool written = writeAll(fd, writer.getBuffer().data(), writer.getBuffer().size());
+  written = written && (fsync(fd) == 0);
+  written = (close(fd) == 0) && written;
+  if (!written)
+  {
+    std::remove(tmp_path.c_str());
+    return false;
+  }
+
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0)
+  {
+    std::remove(tmp_path.c_str());
+    return false;
+  }
+  return syncParentDirectory(path);
+}
+
+bool RegistrySnapshotFile::read( const std::string& path
+                               , std::vector<ComponentInfo>& components
+                               , PipeInfos& pipes )
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+  {
+    close(fd);
+    return false;
+  }
+
+  void* data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+  {
+    return false;
+  }
+
+  const char* begin = static_cast<const char*>(data);
+  SnapshotReader reader(begin, begin + file_stat.st_size);
+  uint32_t magic, format_version, component_count, pipe_count;
+
+  std::vector<ComponentInfo> read_components;
+  PipeInfos read_pipes;
+  bool valid = reader.readU32(magic) &&
+               reader.readU32(format_version) &&
+               magic == SNAPSHOT_MAGIC &&
+               format_version == SNAPSHOT_FORMAT_VERSION &&
+               reader.readU32(component_count);
+
+  for (uint32_t i=0; valid && i<component_count; i++)
+  {
+    ComponentInfo component;
+    valid = readComponent(reader, component);
+    read_components.push_back(component);
+  }
+
+  valid = valid && reader.readU32(pipe_count);
+  for (uint32_t i=0; valid && i<pipe_count; i++)
+  {
+    PipeInfo pipe;
+    valid = readPipe(reader, pipe);
+    read_pipes.push_back(pipe);
+  }
+
+  munmap(data, file_stat.st_size);
+
+  if (!valid)
+  {
+    return false;
+  }
+
+  components = std::move(read_components);
+  pipes = std::move(read_pipes);
+  return true;
+}
+
+} // component_manager namespace
@@ -0,0 +1,205 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Author: Robert Valner */
+
+#include "temoto_component_manager/symbol_table.h"
+#include <algorithm>
+
+namespace temoto_component_manager
+{
+
+/* * * * * * * * * * * *
+ *   INTERNED STRING
+ * * * * * * * * * * * */
+
+namespace
+{
+const std::string& emptyString()
+{
+  static const std::string empty_string;
+  return empty_string;
+}
+}
+
+InternedString::InternedString()
+: symbol_(0)
+, str_(&emptyString())
+{}
+
+InternedString::InternedString(Symbol symbol, const std::string* str)
+: symbol_(symbol)
+, str_(str)
+{}
+
+/* * * * * * * * * * * *
+ *     SYMBOL TABLE
+ * * * * * * * * * * * */
+
+SymbolTable::SymbolTable()
+{
+  intern(emptyString());
+}
+
+Symbol SymbolTable::intern(const std::string& str)
+{
+  return internString(str).symbol();
+}
+
+InternedString SymbolTable::internString(const std::string& str)
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+
+  const auto it = symbols_.find(str);
+  if (it != symbols_.end())
+  {
+    return InternedString(it->second, &strings_[it->second]);
+  }
+
+  Symbol symbol = strings_.size();
+  strings_.push_back(str);
+  symbols_.emplace(str, symbol);
+  return InternedString(symbol, &strings_.back());
+}
+
+bool SymbolTable::find(const std::string& str, Symbol& symbol) const
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+
+  const auto it = symbols_.find(str);
+  if (it == symbols_.end())
+  {
+    return false;
+  }
+  symbol = it->second;
+  return true;
+}
+
+const std::string& SymbolTable::str(Symbol symbol) const
+{
+  std::lock_guard<std::mutex> guard(mutex_);
+  return strings_.at(symbol);
+}
+
+SymbolTable& SymbolTable::keys()
+{
+  // Defined here (and not inline) so that the actions loaded into this process share the same table
+  static SymbolTable table;
+  return table;
+}
+
+SymbolTable& SymbolTable::identifiers()
+{
+  static SymbolTable table;
+  return table;
+}
+
+/* * * * * * * * * * * *
+ *     SYMBOL MASK
+ * * * * * * * * * * * */
+
+void SymbolMask::insert(Symbol symbol)
+{
+  std::size_t word = symbol / 64;
+  if (word >= words_.size())
+  {
+    words_.resize(word + 1, 0);
+  }
+  words_[word] |= uint64_t(1) << (symbol % 64);
+}
+
+bool SymbolMask::contains(Symbol symbol) const
+{
+  std::size_t word = symbol / 64;
+  if (word >= words_.size())
+  {
+    return false;
+  }
+  return (words_[word] >> (symbol % 64)) & 1;
+}
+
+bool SymbolMask::empty() const
+{
+  return std::all_of(words_.begin(), words_.end(), [](uint64_t word){ return word == 0; });
+}
+
+bool SymbolMask::isSubsetOf(const SymbolMask& other) const
+{
+  // Branch-free accumulation of the missing bits, so that the loops can be vectorized
+  const std::size_t common_size = std::min(words_.size(), other.words_.size());
+  uint64_t missing = 0;
+
+  for (std::size_t i = 0; i < common_size; i++)
+  {
+    missing |= words_[i] & ~other.words_[i];
+  }
+  for (std::size_t i = common_size; i < words_.size(); i++)
+  {
+    missing |= words_[i];
+  }
+
+  return missing == 0;
+}
+
+/* * * * * * * * * * * *
+ *     SYMBOL SET
+ * * * * * * * * * * * */
+
+const std::size_t SymbolSet::INLINE_CAPACITY;
+
+SymbolSet::SymbolSet()
+: size_(0)
+, inline_symbols_()
+{}
+
+bool SymbolSet::insert(Symbol symbol)
+{
+  const_iterator insert_it = std::lower_bound(begin(), end(), symbol);
+  if (insert_it != end() && *insert_it == symbol)
+  {
+    return false;
+  }
+  std::size_t index = insert_it - begin();
+
+  if (size_ < INLINE_CAPACITY)
+  {
+    std::copy_backward(inline_symbols_ + index, inline_symbols_ + size_, inline_symbols_ + size_ + 1);
+    inline_symbols_[index] = symbol;
+  }
+  else
+  {
+    // Move to the heap once the inline storage is full
+    if (size_ == INLINE_CAPACITY)
+    {
+      heap_symbols_.assign(inline_symbols_, inline_symbols_ + INLINE_CAPACITY);
+    }
+    heap_symbols_.insert(heap_symbols_.begin() + index, symbol);
+  }
+  size_++;
+  return true;
+}
+
+bool SymbolSet::contains(Symbol symbol) const
+{
+  return std::binary_search(begin(), end(), symbol);
+}
+
+bool SymbolSet::operator==(const SymbolSet& other) const
+{
+  return size_ == other.size_ && std::equal(begin(), end(), other.begin());
+}
+
+} // component_manager namespace
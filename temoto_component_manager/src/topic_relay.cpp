@@ -0,0 +1,131 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Author: Robert Valner */
+
+#include "temoto_component_manager/topic_relay.h"
+
+namespace temoto_component_manager
+{
+
+/* * * * * * * * * * * *
+ *     TOPIC RELAY
+ * * * * * * * * * * * */
+
+TopicRelay::TopicRelay(const std::string& source_topic, const std::string& target_topic)
+: source_topic_(source_topic)
+, target_topic_(target_topic)
+, advertised_(false)
+{}
+
+void TopicRelay::start(const boost::shared_ptr<TopicRelay>& relay)
+{
+  relay->subscriber_ = relay->nh_.subscribe( relay->source_topic_
+                                           , 10
+                                           , &TopicRelay::relayCb
+                                           , relay
+                                           , ros::TransportHints().tcpNoDelay());
+}
+
+void TopicRelay::relayCb(const ros::MessageEvent<topic_tools::ShapeShifter const>& msg_event)
+{
+  const boost::shared_ptr<topic_tools::ShapeShifter const>& msg = msg_event.getConstMessage();
+
+  if (!advertised_)
+  {
+    // Latch the target topic if the source topic is latched
+    const auto latching_it = msg_event.getConnectionHeader().find("latching");
+    bool latch = latching_it != msg_event.getConnectionHeader().end() && latching_it->second == "1";
+
+    publisher_ = msg->advertise(nh_, target_topic_, 10, latch);
+    advertised_ = true;
+  }
+  publisher_.publish(msg);
+}
+
+/* * * * * * * * * * * *
+ *  TOPIC RELAY ENGINE
+ * * * * * * * * * * * */
+
+void TopicRelayEngine::addRelay( temoto_core::temoto_id::ID owner
+                               , const std::string& source_topic
+                               , const std::string& target_topic)
+{
+  RelayKey key(source_topic, target_topic);
+  boost::shared_ptr<TopicRelay> new_relay;
+  {
+    // Lock the mutex
+    std::lock_guard<std::mutex> guard(relays_mutex_);
+    owner_relays_[owner].push_back(key);
+
+    auto relay_it = relays_.find(key);
+    if (relay_it != relays_.end())
+    {
+      relay_it->second.use_count++;
+      return;
+    }
+
+    SharedRelay shared_relay;
+    shared_relay.relay = boost::make_shared<TopicRelay>(source_topic, target_topic);
+    shared_relay.use_count = 1;
+    relays_.emplace(key, shared_relay);
+    new_relay = shared_relay.relay;
+  }
+
+  /*
+   * The relay is started here, outside of the lock, as subscribing goes through the ROS master.
+   * If the relay gets removed meanwhile, it is stopped once the last reference is dropped
+   */
+  TopicRelay::start(new_relay);
+}
+
+void TopicRelayEngine::removeRelays(temoto_core::temoto_id::ID owner)
+{
+  std::vector<boost::shared_ptr<TopicRelay>> stopped_relays;
+  {
+    // Lock the mutex
+    std::lock_guard<std::mutex> guard(relays_mutex_);
+    auto owner_it = owner_relays_.find(owner);
+    if (owner_it == owner_relays_.end())
+    {
+      return;
+    }
+
+    for (const RelayKey& key : owner_it->second)
+    {
+      auto relay_it = relays_.find(key);
+      if (relay_it == relays_.end() || --relay_it->second.use_count > 0)
+      {
+        continue;
+      }
+      stopped_relays.push_back(relay_it->second.relay);
+      relays_.erase(relay_it);
+    }
+    owner_relays_.erase(owner_it);
+  }
+
+  // The relays are stopped here, outside of the lock
+  stopped_relays.clear();
+}
+
+std::size_t TopicRelayEngine::getRelayCount() const
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(relays_mutex_);
+  return relays_.size();
+}
+
+} // component_manager namespace
@@ -0,0 +1,223 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Author: Robert Valner */
+
+#include "temoto_component_manager/warm_pool.h"
+#include <algorithm>
+#include <functional>
+
+namespace temoto_component_manager
+{
+
+WarmPool::WarmPool(const Config& config)
+: config_(config)
+, used_memory_mb_(0)
+, used_cpu_(0)
+{}
+
+bool WarmPool::enabled() const
+{
+  return config_.size > 0;
+}
+
+void WarmPool::recordRequest(const std::string& component_type)
+{
+  if (!enabled())
+  {
+    return;
+  }
+
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(mutex_);
+  requests_[component_type].push_back(Clock::now());
+  pruneRequests();
+}
+
+std::vector<std::string> WarmPool::getTypesToWarm()
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(mutex_);
+  pruneRequests();
+
+  std::vector<std::pair<std::size_t, std::string>> hot_types;
+  for (const auto& type_requests : requests_)
+  {
+    if (!isHot(type_requests.first))
+    {
+      continue;
+    }
+
+    bool has_instance = std::any_of( instances_.begin()
+                                   , instances_.end()
+                                   , [&type_requests](const Instance& instance)
+                                     {
+                                       return instance.component->getType() == type_requests.first;
+                                     });
+    if (!has_instance)
+    {
+      hot_types.emplace_back(type_requests.second.size(), type_requests.first);
+    }
+  }
+
+  // The most requested types get the room first
+  std::sort(hot_types.begin(), hot_types.end(), std::greater<std::pair<std::size_t, std::string>>());
+
+  std::vector<std::string> types_to_warm;
+  double memory_mb = used_memory_mb_;
+  double cpu = used_cpu_;
+  for (const auto& hot_type : hot_types)
+  {
+    if (instances_.size() + types_to_warm.size() >= std::size_t(config_.size))
+    {
+      break;
+    }
+
+    double type_memory_mb = getCost(config_.memory_mb, hot_type.second);
+    double type_cpu = getCost(config_.cpu, hot_type.second);
+    if (!fitsBudget(memory_mb + type_memory_mb, cpu + type_cpu))
+    {
+      continue;
+    }
+
+    memory_mb += type_memory_mb;
+    cpu += type_cpu;
+    types_to_warm.push_back(hot_type.second);
+  }
+  return types_to_warm;
+}
+
+bool WarmPool::add(const Instance& instance)
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(mutex_);
+
+  const std::string& component_type = instance.component->getType();
+  double memory_mb = used_memory_mb_ + getCost(config_.memory_mb, component_type);
+  double cpu = used_cpu_ + getCost(config_.cpu, component_type);
+  if (instances_.size() >= std::size_t(config_.size) || !fitsBudget(memory_mb, cpu))
+  {
+    return false;
+  }
+
+  used_memory_mb_ = memory_mb;
+  used_cpu_ = cpu;
+  instances_.push_back(instance);
+  return true;
+}
+
+bool WarmPool::take(const ComponentInfoConstPtrs& candidates, Instance& instance)
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(mutex_);
+
+  for (const auto& candidate : candidates)
+  {
+    auto instance_it = std::find_if( instances_.begin()
+                                   , instances_.end()
+                                   , [&candidate](const Instance& i)
+                                     {
+                                       return i.component->hasSameIdentity(*candidate);
+                                     });
+    if (instance_it == instances_.end())
+    {
+      continue;
+    }
+
+    instance = *instance_it;
+    instance.component = candidate;
+    release(*instance_it);
+    instances_.erase(instance_it);
+    return true;
+  }
+  return false;
+}
+
+std::vector<WarmPool::Instance> WarmPool::takeCold()
+{
+  // Lock the mutex
+  std::lock_guard<std::mutex> guard(mutex_);
+  pruneRequests();
+
+  std::vector<Instance> cold_instances;
+  for (auto instance_it = instances_.begin(); instance_it != instances_.end();)
+  {
+    if (isHot(instance_it->component->getType()))
+    {
+      ++instance_it;
+      continue;
+    }
+
+    cold_instances.push_back(*instance_it);
+    release(*instance_it);
+    instance_it = instances_.erase(instance_it);
+  }
+  return cold_instances;
+}
+
+double WarmPool::getCost(const std::map<std::string, double>& costs, const std::string& component_type)
+{
+  auto cost_it = costs.find(component_type);
+  if (cost_it == costs.end())
+  {
+    cost_it = costs.find("default");
+  }
+  return (cost_it != costs.end()) ? cost_it->second : 0;
+}
+
+bool WarmPool::fitsBudget(double memory_mb, double cpu) const
+{
+  return (config_.memory_budget_mb <= 0 || memory_mb <= config_.memory_budget_mb) &&
+         (config_.cpu_budget <= 0 || cpu <= config_.cpu_budget);
+}
+
+void WarmPool::pruneRequests()
+{
+  const Clock::time_point oldest = Clock::now() - std::chrono::duration_cast<Clock::duration>(
+    std::chrono::duration<double>(config_.window));
+
+  for (auto type_it = requests_.begin(); type_it != requests_.end();)
+  {
+    std::deque<Clock::time_point>& times = type_it->second;
+    while (!times.empty() && times.front() < oldest)
+    {
+      times.pop_front();
+    }
+
+    if (times.empty())
+    {
+      type_it = requests_.erase(type_it);
+    }
+    else
+    {
+      ++type_it;
+    }
+  }
+}
+
+bool WarmPool::isHot(const std::string& component_type) const
+{
+  auto type_it = requests_.find(component_type);
+  return type_it != requests_.end() && type_it->second.size() >= std::size_t(config_.hot_requests);
+}
+
+void WarmPool::release(const Instance& instance)
+{
+  used_memory_mb_ -= getCost(config_.memory_mb, instance.component->getType());
+  used_cpu_ -= getCost(config_.cpu, instance.component->getType());
+}
+
+} // component_manager namespace
@@ -0,0 +1,356 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Copyright 2019 TeMoto Telerobotics
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/* Author: Robert Valner */
+
+/*
+ * Checks that the position based buckets of ComponentInfoIndex and PipeCatalog stay consistent
+ * with the stored components and pipes when they are added, updated and removed
+ */
+
+#include "temoto_component_manager/component_info_index.h"
+#include "temoto_component_manager/pipe_catalog.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace temoto_component_manager;
+
+namespace
+{
+
+Symbol identifier(const std::string& str)
+{
+  return SymbolTable::identifiers().intern(str);
+}
+
+ComponentInfo makeComponent(const std::string& name, const std::string& type, float reliability)
+{
+  ComponentInfo ci(name);
+  ci.setType(type);
+  ci.setPackageName("test_package");
+  ci.setExecutable(name);
+  ci.resetReliability(reliability);
+  return ci;
+}
+
+/// Names of the components in the bucket, in the order of the bucket
+std::vector<std::string> componentNames(const ComponentInfoIndex& index, const ComponentInfoIndex::Bucket* bucket)
+{
+  std::vector<std::string> names;
+  if (bucket != NULL)
+  {
+    for (std::size_t position : *bucket)
+    {
+      names.push_back(index.getComponents().at(position)->getName());
+    }
+  }
+  return names;
+}
+
+/**
+ * @brief Checks that each bucket of each component holds its position exactly once and that the
+ * buckets are ordered by decreasing reliability
+ */
+void expectConsistent(const ComponentInfoIndex& index)
+{
+  const ComponentInfoConstPtrs& components = index.getComponents();
+  for (std::size_t position = 0; position < components.size(); position++)
+  {
+    const ComponentInfo& ci = *components[position];
+    EXPECT_EQ(components[position], index.find(ci));
+
+    for (const ComponentInfoIndex::Bucket* bucket : { index.findByType(ci.getTypeSymbol())
+                                                    , index.findByName(ci.getNameSymbol())
+                                                    , index.findByPackageExecutable(ci.getPackageNameSymbol(), ci.getExecutableSymbol())
+                                                    , index.findByNamespace(ci.getTemotoNamespaceSymbol()) })
+    {
+      ASSERT_TRUE(bucket != NULL);
+      EXPECT_EQ(1, std::count(bucket->begin(), bucket->end(), position));
+      for (std::size_t i = 0; i < bucket->size(); i++)
+      {
+        ASSERT_LT(bucket->at(i), components.size());
+        if (i > 0)
+        {
+          EXPECT_GE(components[bucket->at(i - 1)]->getReliability(), components[bucket->at(i)]->getReliability());
+        }
+      }
+    }
+  }
+}
+
+PipeInfo makePipe( const std::string& name
+                 , const std::string& category
+                 , const std::vector<std::string>& output_topic_types
+                 , float reliability)
+{
+  Segment segment;
+  segment.segment_type_ = name + "_segment";
+  for (const std::string& topic_type : output_topic_types)
+  {
+    segment.addOutputTopicType(topic_type);
+  }
+
+  PipeInfo pi;
+  pi.setName(name);
+  pi.setType(category);
+  pi.setSegments({segment});
+  pi.reliability_.resetReliability(reliability);
+  return pi;
+}
+
+std::vector<std::string> pipeNames(const PipeCatalog& catalog, const PipeCatalog::Bucket& bucket)
+{
+  std::vector<std::string> names;
+  for (std::size_t position : bucket)
+  {
+    names.push_back(catalog.getPipes().at(position)->getName());
+  }
+  return names;
+}
+
+std::vector<std::string> categoryNames(const PipeCatalog& catalog, const std::string& category)
+{
+  const PipeCatalog::Bucket* bucket = catalog.findByCategory(category);
+  return (bucket != NULL) ? pipeNames(catalog, *bucket) : std::vector<std::string>();
+}
+
+std::vector<std::string> outputTopicTypeNames( const PipeCatalog& catalog
+                                             , const std::string& category
+                                             , const std::vector<std::string>& topic_types)
+{
+  std::vector<Symbol> topic_type_symbols;
+  for (const std::string& topic_type : topic_types)
+  {
+    topic_type_symbols.push_back(SymbolTable::keys().intern(topic_type));
+  }
+
+  PipeCatalog::Bucket candidates;
+  catalog.findByOutputTopicTypes(category, topic_type_symbols, candidates);
+  return pipeNames(catalog, candidates);
+}
+
+/**
+ * @brief Checks that the name, content and category indexes point at the right pipes
+ */
+void expectConsistent(const PipeCatalog& catalog)
+{
+  const PipeInfoConstPtrs& pipes = catalog.getPipes();
+  std::size_t categorized_count = 0;
+  for (const auto& category : catalog.getCategories())
+  {
+    categorized_count += category.second.size();
+    for (std::size_t i = 0; i < category.second.size(); i++)
+    {
+      ASSERT_LT(category.second[i], pipes.size());
+      EXPECT_EQ(category.first, pipes[category.second[i]]->getType());
+      if (i > 0)
+      {
+        EXPECT_GE( pipes[category.second[i - 1]]->reliability_.getReliability()
+                 , pipes[category.second[i]]->reliability_.getReliability());
+      }
+    }
+  }
+  EXPECT_EQ(pipes.size(), categorized_count);
+
+  for (std::size_t position = 0; position < pipes.size(); position++)
+  {
+    const PipeInfo& pi = *pipes[position];
+    EXPECT_EQ(pipes[position], catalog.find(pi));
+    EXPECT_EQ(int(position), catalog.findByName(pi.getName()));
+
+    SymbolMask output_topic_types;
+    for (Symbol topic_type : pi.getSegments().back().required_output_topic_types_)
+    {
+      output_topic_types.insert(topic_type);
+    }
+    EXPECT_TRUE(catalog.getOutputTopicTypes(position).isSubsetOf(output_topic_types));
+    EXPECT_TRUE(output_topic_types.isSubsetOf(catalog.getOutputTopicTypes(position)));
+  }
+}
+
+} // anonymous namespace
+
+TEST(ComponentInfoIndex, AddOrdersBucketsByReliability)
+{
+  ComponentInfoIndex index;
+  EXPECT_TRUE(index.add(std::make_shared<const ComponentInfo>(makeComponent("a", "camera", 0.2))));
+  EXPECT_TRUE(index.add(std::make_shared<const ComponentInfo>(makeComponent("b", "camera", 0.8))));
+  EXPECT_TRUE(index.add(std::make_shared<const ComponentInfo>(makeComponent("c", "camera", 0.5))));
+  EXPECT_TRUE(index.add(std::make_shared<const ComponentInfo>(makeComponent("d", "lidar", 0.5))));
+  EXPECT_FALSE(index.add(std::make_shared<const ComponentInfo>(makeComponent("a", "camera", 0.9))));
+
+  EXPECT_EQ((std::vector<std::string>{"b", "c", "a"}), componentNames(index, index.findByType(identifier("camera"))));
+  EXPECT_EQ((std::vector<std::string>{"d"}), componentNames(index, index.findByType(identifier("lidar"))));
+  EXPECT_TRUE(index.findByType(identifier("gripper")) == NULL);
+  expectConsistent(index);
+}
+
+TEST(ComponentInfoIndex, UpdateReordersBuckets)
+{
+  ComponentInfoIndex index;
+  for (const ComponentInfo& ci : { makeComponent("a", "camera", 0.2)
+                                 , makeComponent("b", "camera", 0.8)
+                                 , makeComponent("c", "camera", 0.5) })
+  {
+    index.add(std::make_shared<const ComponentInfo>(ci));
+  }
+
+  EXPECT_TRUE(index.update(makeComponent("a", "camera", 0.9), true));
+  EXPECT_EQ((std::vector<std::string>{"a", "b", "c"}), componentNames(index, index.findByType(identifier("camera"))));
+  EXPECT_TRUE(index.find(makeComponent("a", "camera", 0))->getAdvertised());
+
+  // An equally reliable component that is reindexed goes after the others
+  EXPECT_TRUE(index.update(makeComponent("a", "camera", 0.8), false));
+  EXPECT_EQ((std::vector<std::string>{"b", "a", "c"}), componentNames(index, index.findByType(identifier("camera"))));
+
+  // A type change moves the component to another bucket
+  EXPECT_TRUE(index.update(makeComponent("c", "lidar", 0.5), false));
+  EXPECT_EQ((std::vector<std::string>{"b", "a"}), componentNames(index, index.findByType(identifier("camera"))));
+  EXPECT_EQ((std::vector<std::string>{"c"}), componentNames(index, index.findByType(identifier("lidar"))));
+
+  EXPECT_FALSE(index.update(makeComponent("e", "camera", 0.5), false));
+  expectConsistent(index);
+}
+
+TEST(ComponentInfoIndex, RemoveMiddleMovesLast)
+{
+  ComponentInfoIndex index;
+  for (const ComponentInfo& ci : { makeComponent("a", "camera", 0.2)
+                                 , makeComponent("b", "camera", 0.8)
+                                 , makeComponent("c", "camera", 0.5)
+                                 , makeComponent("d", "lidar", 0.5) })
+  {
+    index.add(std::make_shared<const ComponentInfo>(ci));
+  }
+
+  EXPECT_TRUE(index.remove(makeComponent("b", "camera", 0)));
+  ASSERT_EQ(3u, index.getComponents().size());
+  EXPECT_EQ("d", index.getComponents()[1]->getName());
+  EXPECT_TRUE(index.find(makeComponent("b", "camera", 0)) == NULL);
+  EXPECT_TRUE(index.findByName(identifier("b")) == NULL);
+  EXPECT_EQ((std::vector<std::string>{"c", "a"}), componentNames(index, index.findByType(identifier("camera"))));
+  EXPECT_EQ((std::vector<std::string>{"d"}), componentNames(index, index.findByType(identifier("lidar"))));
+  expectConsistent(index);
+
+  EXPECT_FALSE(index.remove(makeComponent("b", "camera", 0)));
+}
+
+TEST(ComponentInfoIndex, RemoveLast)
+{
+  ComponentInfoIndex index;
+  for (const ComponentInfo& ci : { makeComponent("a", "camera", 0.2)
+                                 , makeComponent("b", "camera", 0.8)
+                                 , makeComponent("c", "lidar", 0.5) })
+  {
+    index.add(std::make_shared<const ComponentInfo>(ci));
+  }
+
+  EXPECT_TRUE(index.remove(makeComponent("c", "lidar", 0)));
+  ASSERT_EQ(2u, index.getComponents().size());
+  EXPECT_EQ("a", index.getComponents()[0]->getName());
+  EXPECT_EQ("b", index.getComponents()[1]->getName());
+  EXPECT_TRUE(index.findByType(identifier("lidar")) == NULL);
+  EXPECT_EQ((std::vector<std::string>{"b", "a"}), componentNames(index, index.findByType(identifier("camera"))));
+  expectConsistent(index);
+
+  EXPECT_TRUE(index.remove(makeComponent("b", "camera", 0)));
+  EXPECT_TRUE(index.remove(makeComponent("a", "camera", 0)));
+  EXPECT_TRUE(index.getComponents().empty());
+  EXPECT_TRUE(index.findByType(identifier("camera")) == NULL);
+}
+
+TEST(PipeCatalog, AddUpdateRemoveReordersCategory)
+{
+  PipeCatalog catalog;
+  EXPECT_TRUE(catalog.add(std::make_shared<const PipeInfo>(makePipe("p0", "track", {"image"}, 0.2))));
+  EXPECT_TRUE(catalog.add(std::make_shared<const PipeInfo>(makePipe("p1", "track", {"image"}, 0.8))));
+  EXPECT_TRUE(catalog.add(std::make_shared<const PipeInfo>(makePipe("p2", "track", {"depth"}, 0.5))));
+  EXPECT_TRUE(catalog.add(std::make_shared<const PipeInfo>(makePipe("p3", "detect", {}, 0.5))));
+  EXPECT_FALSE(catalog.add(std::make_shared<const PipeInfo>(makePipe("p0", "track", {"image"}, 0.9))));
+  EXPECT_EQ((std::vector<std::string>{"p1", "p2", "p0"}), categoryNames(catalog, "track"));
+  expectConsistent(catalog);
+
+  // The feasibility is kept over updates and follows the pipe that is moved by a removal
+  catalog.setFeasible(catalog.findByName("p3"), true);
+
+  EXPECT_TRUE(catalog.update(std::make_shared<const PipeInfo>(makePipe("p0", "track", {"image"}, 0.9))));
+  EXPECT_EQ((std::vector<std::string>{"p0", "p1", "p2"}), categoryNames(catalog, "track"));
+  EXPECT_TRUE(catalog.isFeasible(catalog.findByName("p3")));
+  expectConsistent(catalog);
+
+  // Removing a pipe in the middle moves the last one into its place
+  EXPECT_TRUE(catalog.remove(makePipe("p1", "track", {"image"}, 0)));
+  ASSERT_EQ(3u, catalog.getPipes().size());
+  EXPECT_EQ("p3", catalog.getPipes()[1]->getName());
+  EXPECT_EQ(1, catalog.findByName("p3"));
+  EXPECT_EQ(-1, catalog.findByName("p1"));
+  EXPECT_TRUE(catalog.isFeasible(1));
+  EXPECT_EQ((std::vector<std::string>{"p0", "p2"}), categoryNames(catalog, "track"));
+  EXPECT_EQ((std::vector<std::string>{"p3"}), categoryNames(catalog, "detect"));
+  expectConsistent(catalog);
+
+  // Removing the last pipe moves nothing
+  EXPECT_TRUE(catalog.remove(makePipe("p2", "track", {"depth"}, 0)));
+  ASSERT_EQ(2u, catalog.getPipes().size());
+  EXPECT_EQ("p0", catalog.getPipes()[0]->getName());
+  EXPECT_EQ("p3", catalog.getPipes()[1]->getName());
+  EXPECT_EQ((std::vector<std::string>{"p0"}), categoryNames(catalog, "track"));
+  EXPECT_TRUE(catalog.findBySegmentType(identifier("p2_segment")) == NULL);
+  expectConsistent(catalog);
+
+  EXPECT_FALSE(catalog.remove(makePipe("p2", "track", {"depth"}, 0)));
+}
+
+TEST(PipeCatalog, FindByOutputTopicTypesKeepsCategoryOrder)
+{
+  PipeCatalog catalog;
+  catalog.add(std::make_shared<const PipeInfo>(makePipe("p0", "track", {"image"}, 0.5)));
+  catalog.add(std::make_shared<const PipeInfo>(makePipe("p1", "track", {}, 0.9)));
+  catalog.add(std::make_shared<const PipeInfo>(makePipe("p2", "track", {"image", "depth"}, 0.5)));
+  catalog.add(std::make_shared<const PipeInfo>(makePipe("p3", "track", {"depth"}, 0.7)));
+  catalog.add(std::make_shared<const PipeInfo>(makePipe("p4", "track", {"pointcloud"}, 1.0)));
+  catalog.add(std::make_shared<const PipeInfo>(makePipe("p5", "detect", {"image"}, 1.0)));
+
+  // The pipes without outputs and the ones that provide any of the types, each listed once,
+  // by decreasing reliability and then in the order they were indexed
+  EXPECT_EQ( (std::vector<std::string>{"p1", "p3", "p0", "p2"})
+           , outputTopicTypeNames(catalog, "track", {"image", "depth"}));
+  EXPECT_EQ( (std::vector<std::string>{"p1", "p0", "p2"})
+           , outputTopicTypeNames(catalog, "track", {"image"}));
+  EXPECT_EQ((std::vector<std::string>{"p1"}), outputTopicTypeNames(catalog, "track", {"rgb"}));
+  EXPECT_TRUE(outputTopicTypeNames(catalog, "grasp", {"image"}).empty());
+
+  // A reindexed pipe goes after the equally reliable ones, in the category and in the candidates
+  catalog.update(std::make_shared<const PipeInfo>(makePipe("p0", "track", {"image"}, 0.5)));
+  EXPECT_EQ((std::vector<std::string>{"p4", "p1", "p3", "p2", "p0"}), categoryNames(catalog, "track"));
+  EXPECT_EQ( (std::vector<std::string>{"p1", "p3", "p2", "p0"})
+           , outputTopicTypeNames(catalog, "track", {"image", "depth"}));
+
+  // The removal moves the last pipe (p5) into the place of p1
+  catalog.remove(makePipe("p1", "track", {}, 0));
+  EXPECT_EQ( (std::vector<std::string>{"p4", "p3", "p2", "p0"})
+           , outputTopicTypeNames(catalog, "track", {"image", "depth", "pointcloud"}));
+  EXPECT_EQ((std::vector<std::string>{"p5"}), outputTopicTypeNames(catalog, "detect", {"image"}));
+  expectConsistent(catalog);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}